@@ -0,0 +1,57 @@
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+#include <QtCore/QtCore>
+#include "MpvPercentile.hpp"
+
+#ifdef Q_OS_WINDOWS
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif  // Q_OS_WINDOWS
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif  // Q_OS_UNIX
+
+// Process CPU time of all threads, user and kernel. std::clock() is wall
+// time on MSVC.
+inline double cpuSeconds() {
+#ifdef Q_OS_WINDOWS
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel,
+                       &user)) {
+    return 0;
+  }
+  // In units of 100 nanoseconds
+  auto seconds = [](const FILETIME& time) {
+    return double(quint64(time.dwHighDateTime) << 32 | time.dwLowDateTime) /
+           1e7;
+  };
+  return seconds(kernel) + seconds(user);
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif  // Q_OS_WINDOWS
+}
+
+// Resident set size in bytes, 0 where /proc is not available
+inline qint64 residentBytes() {
+#ifdef Q_OS_UNIX
+  QFile statm("/proc/self/statm");
+  if (!statm.open(QIODevice::ReadOnly)) {
+    return 0;
+  }
+  QList<QByteArray> fields = statm.readAll().split(' ');
+  static const qint64 page_size = sysconf(_SC_PAGESIZE);
+  return fields.size() > 1 ? fields[1].toLongLong() * page_size : 0;
+#else
+  return 0;
+#endif  // Q_OS_UNIX
+}
+
+#endif  // BENCH_UTIL_HPP
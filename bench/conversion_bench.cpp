@@ -0,0 +1,158 @@
+// Benchmarks the QVariant <-> mpv_node conversions of libmpv_qthelper.hpp,
+// which every command, property and event goes through.
+//
+// MpvPlayerConversionBench -median 5
+// MpvPlayerConversionBench buildNode:track-list buildNodeReference:track-list
+//
+// buildNodeReference times node_builder before its map and list changes, as
+// the baseline of buildNode.
+#include <clocale>
+#include <QtCore/QtCore>
+#include <QtTest/QtTest>
+#include "libmpv_qthelper.hpp"
+#include "libmpv_qthelper_reference.hpp"
+
+namespace {
+QVariantMap track(int id, const QString& type) {
+  return {{"id", id},
+          {"type", type},
+          {"src-id", id},
+          {"title", QString("%1 track %2").arg(type).arg(id)},
+          {"lang", "eng"},
+          {"image", false},
+          {"albumart", false},
+          {"default", id == 1},
+          {"forced", false},
+          {"external", false},
+          {"selected", id == 1},
+          {"ff-index", id - 1},
+          {"codec", type == "video" ? "h264" : "aac"},
+          {"demux-w", 1920},
+          {"demux-h", 1080},
+          {"demux-fps", 30.0},
+          {"demux-bitrate", 4000000}};
+}
+
+QVariant trackList() {
+  QVariantList tracks;
+  for (int id = 1; id <= 4; ++id) {
+    tracks << track(id, "video") << track(id, "audio");
+  }
+  return tracks;
+}
+
+QVariant demuxerCacheState() {
+  QVariantList ranges;
+  for (int i = 0; i < 8; ++i) {
+    ranges << QVariantMap{{"start", i * 10.0}, {"end", i * 10.0 + 8}};
+  }
+  return QVariantMap{{"seekable-ranges", ranges},
+                     {"bof-cached", true},
+                     {"eof-cached", false},
+                     {"cache-end", 78.0},
+                     {"reader-pts", 70.5},
+                     {"cache-duration", 7.5},
+                     {"fw-bytes", 3932160},
+                     {"total-bytes", 41943040},
+                     {"raw-input-rate", 524288},
+                     {"idle", false},
+                     {"underrun", false}};
+}
+
+QVariant screenshotRaw() {
+  const int width = 1920;
+  const int height = 1080;
+  return QVariantMap{{"w", width},
+                     {"h", height},
+                     {"stride", width * 4},
+                     {"format", "bgr0"},
+                     {"data", QByteArray(width * height * 4, '\0')}};
+}
+
+QVariant nestedMap(int depth, int width) {
+  QVariantMap map;
+  for (int i = 0; i < width; ++i) {
+    QString key = QString("key-%1").arg(i, 3, 10, QChar('0'));
+    map.insert(key, depth > 1 ? nestedMap(depth - 1, width) : QVariant(i));
+  }
+  return map;
+}
+}  // namespace
+
+class ConversionBench : public QObject {
+  Q_OBJECT
+
+ private:
+  void payloads() {
+    QTest::addColumn<QVariant>("payload");
+    QTest::newRow("command")
+        << QVariant(QVariantList{"loadfile", "/videos/camera-01.mkv",
+                                 "replace"});
+    QTest::newRow("command-options")
+        << QVariant(QVariantList{
+               "loadfile", "rtsp://camera-01/stream", "replace", -1,
+               QVariantMap{{"cache", "yes"}, {"demuxer-max-bytes", "64MiB"}}});
+    QTest::newRow("track-list") << trackList();
+    QTest::newRow("demuxer-cache-state") << demuxerCacheState();
+    QTest::newRow("screenshot-raw") << screenshotRaw();
+    QTest::newRow("nested-map") << nestedMap(3, 16);
+    // Large enough to show a conversion which is quadratic in the map size
+    QTest::newRow("flat-map") << nestedMap(1, 1024);
+  }
+
+  Q_SLOT void initTestCase() {
+    // libmpv requires the LC_NUMERIC category to be set to "C"
+    std::setlocale(LC_NUMERIC, "C");
+  }
+
+  Q_SLOT void buildNode_data() { payloads(); }
+  Q_SLOT void buildNode() {
+    QFETCH(QVariant, payload);
+    QBENCHMARK {
+      mpv::qt::node_builder node(payload);
+      Q_UNUSED(node)
+    }
+  }
+
+  Q_SLOT void buildNodeReference_data() { payloads(); }
+  Q_SLOT void buildNodeReference() {
+    QFETCH(QVariant, payload);
+    QBENCHMARK {
+      mpv::qt::reference::node_builder node(payload);
+      Q_UNUSED(node)
+    }
+  }
+
+  Q_SLOT void nodeToVariant_data() { payloads(); }
+  Q_SLOT void nodeToVariant() {
+    QFETCH(QVariant, payload);
+    mpv::qt::node_builder node(payload);
+    QVariant result;
+    QBENCHMARK { result = mpv::qt::node_to_variant(node.node()); }
+    QCOMPARE(result, payload);
+  }
+
+  // A synchronous command through an idle core, build and conversion of
+  // the result included
+  Q_SLOT void commandVariant_data() {
+    QTest::addColumn<QVariant>("payload");
+    QTest::newRow("ignore") << QVariant(QVariantList{"ignore"});
+    QTest::newRow("expand-text")
+        << QVariant(QVariantList{"expand-text", "${mpv-version}"});
+    QTest::newRow("expand-track-list")
+        << QVariant(QVariantList{"expand-text", "${track-list}"});
+  }
+  Q_SLOT void commandVariant() {
+    QFETCH(QVariant, payload);
+    mpv_handle* mpv = mpv_create();
+    QVERIFY(mpv);
+    mpv_set_option_string(mpv, "vo", "null");
+    mpv_set_option_string(mpv, "ao", "null");
+    QCOMPARE(mpv_initialize(mpv), 0);
+    QBENCHMARK { mpv::qt::command_variant(mpv, payload); }
+    mpv_terminate_destroy(mpv);
+  }
+};
+
+QTEST_GUILESS_MAIN(ConversionBench)
+#include "conversion_bench.moc"
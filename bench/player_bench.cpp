@@ -0,0 +1,210 @@
+// Benchmarks players on synthetic lavfi sources with the software renderer,
+// so that it runs on machines without a GPU, and prints JSON results for
+// regression tracking.
+//
+// MpvPlayerBench --players 1,4,16,64 --seconds 10 --output bench.json
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <QtCore/QtCore>
+#include <MpvPlayer.hpp>
+#include "bench_util.hpp"
+
+namespace {
+const char kDefaultSource[] = "av://lavfi:testsrc2=size=1920x1080:rate=30";
+
+QJsonObject distribution(const std::vector<double>& values) {
+  return {{"p50", percentileOf(values, 50)},
+          {"p90", percentileOf(values, 90)},
+          {"p99", percentileOf(values, 99)},
+          {"samples", int(values.size())}};
+}
+
+MpvPlayerOptions benchOptions() {
+  MpvPlayerOptions options = MpvPlayerOptions::defaults();
+  options.set("vo", "libmpv");
+  options.set("ao", "null");
+  options.set("hwdec", "no");
+  return options;
+}
+
+QJsonObject benchCreateDestroy(int count) {
+  MpvPlayerOptions options = benchOptions();
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<MpvPlayerObject*> players;
+  for (int i = 0; i < count; ++i) {
+    players.push_back(new MpvPlayerObject(options, QString::number(i)));
+  }
+  double create_seconds = timer.nsecsElapsed() / 1e9;
+  timer.restart();
+  qDeleteAll(players);
+  MpvPlayer::waitForTeardown();
+  double destroy_seconds = timer.nsecsElapsed() / 1e9;
+  return {{"players", count},
+          {"create_per_second", count / std::max(create_seconds, 1e-9)},
+          {"destroy_per_second", count / std::max(destroy_seconds, 1e-9)}};
+}
+
+// Round trips of a synchronous command, and of a property change until the
+// event thread observed it, in microseconds
+QJsonObject benchLatency(const QString& source, int iterations) {
+  MpvPlayerObject player(benchOptions(), "latency");
+  player.observePlayerProperty("volume");
+  QEventLoop loop;
+  QObject::connect(&player, &MpvPlayerObject::playStateChanged, &loop,
+                   [&](int state) {
+                     if (state == MpvPlayer::Play) {
+                       loop.quit();
+                     }
+                   });
+  QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+  player.play(source);
+  if (player.playState() != MpvPlayer::Play) {
+    loop.exec();
+  }
+
+  std::vector<double> commands;
+  std::vector<double> events;
+  QElapsedTimer timer;
+  for (int i = 0; i < iterations; ++i) {
+    timer.start();
+    player.command(QVariantList{"ignore"});
+    commands.push_back(timer.nsecsElapsed() / 1e3);
+
+    int volume = 50 + i % 2;
+    timer.start();
+    player.setPlayerProperty("volume", volume);
+    while (player.observedPlayerProperty("volume").toInt() != volume &&
+           timer.elapsed() < 1000) {
+      std::this_thread::yield();
+    }
+    events.push_back(timer.nsecsElapsed() / 1e3);
+  }
+  return {{"command_round_trip_us", distribution(commands)},
+          {"event_dispatch_us", distribution(events)}};
+}
+
+QJsonObject benchPlayback(const QString& source, int count, int seconds) {
+  MpvPlayerOptions options = benchOptions();
+  qint64 rss = residentBytes();
+  std::vector<double> first_frames;
+  qint64 frames = 0;
+  bool measuring = false;
+  QEventLoop startup;
+
+  std::vector<MpvPlayerObject*> players;
+  for (int i = 0; i < count; ++i) {
+    auto* player = new MpvPlayerObject(options, QString::number(i));
+    QObject::connect(player, &MpvPlayerObject::startupFinished,
+                     [&](const MpvPlayer::StartupTimeline& timeline) {
+                       first_frames.push_back(timeline.timeToFirstFrame() /
+                                              1e6);
+                       if (int(first_frames.size()) == count) {
+                         startup.quit();
+                       }
+                     });
+    QObject::connect(player, &MpvPlayerObject::frameReady, [&] {
+      if (measuring) {
+        ++frames;
+      }
+    });
+    players.push_back(player);
+  }
+  for (MpvPlayerObject* player : players) {
+    player->play(source);
+  }
+  QTimer::singleShot(30000, &startup, &QEventLoop::quit);
+  startup.exec();
+  bool started = int(first_frames.size()) == count;
+  qint64 rss_per_player = (residentBytes() - rss) / count;
+
+  measuring = true;
+  double cpu = cpuSeconds();
+  QElapsedTimer timer;
+  timer.start();
+  QEventLoop window;
+  QTimer::singleShot(seconds * 1000, &window, &QEventLoop::quit);
+  window.exec();
+  double wall_seconds = timer.nsecsElapsed() / 1e9;
+  cpu = cpuSeconds() - cpu;
+  measuring = false;
+
+  qDeleteAll(players);
+  MpvPlayer::waitForTeardown();
+  return {{"players", count},
+          {"started", started},
+          {"time_to_first_frame_ms", distribution(first_frames)},
+          {"frames_per_second", frames / wall_seconds},
+          {"frames_per_second_per_player", frames / wall_seconds / count},
+          {"cpu_seconds_per_second", cpu / wall_seconds},
+          {"rss_bytes_per_player", rss_per_player}};
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // Qt sets the locale in the QCoreApplication constructor, but libmpv
+  // requires the LC_NUMERIC category to be set to "C", so change it back.
+  std::setlocale(LC_NUMERIC, "C");
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  parser.addOption(QCommandLineOption(QStringList() << "players",
+                                      "Player counts of the playback runs",
+                                      "counts", "1,4,16,64"));
+  parser.addOption(QCommandLineOption(QStringList() << "seconds",
+                                      "Seconds of each playback run",
+                                      "seconds", "10"));
+  parser.addOption(QCommandLineOption(QStringList() << "source",
+                                      "Source of every player", "url",
+                                      kDefaultSource));
+  parser.addOption(QCommandLineOption(QStringList() << "iterations",
+                                      "Iterations of the latency runs",
+                                      "iterations", "1000"));
+  parser.addOption(QCommandLineOption(QStringList() << "output",
+                                      "JSON file, stdout by default",
+                                      "file"));
+  parser.process(app);
+
+  QString source = parser.value("source");
+  int seconds = std::max(parser.value("seconds").toInt(), 1);
+  int iterations = std::max(parser.value("iterations").toInt(), 1);
+  QList<int> counts;
+  for (const QString& count : parser.value("players").split(',')) {
+    if (count.toInt() > 0) {
+      counts << count.toInt();
+    }
+  }
+
+  QJsonObject results;
+  results["source"] = source;
+  int max_count =
+      counts.isEmpty() ? 16 : *std::max_element(counts.cbegin(), counts.cend());
+  results["create_destroy"] = benchCreateDestroy(max_count);
+  results["latency"] = benchLatency(source, iterations);
+  QJsonArray playback;
+  for (int count : counts) {
+    std::fprintf(stderr, "playback with %d players\n", count);
+    playback.append(benchPlayback(source, count, seconds));
+  }
+  results["playback"] = playback;
+
+  QByteArray json = QJsonDocument(results).toJson();
+  if (!parser.isSet("output")) {
+    std::fwrite(json.constData(), 1, json.size(), stdout);
+    return EXIT_SUCCESS;
+  }
+  QSaveFile file(parser.value("output"));
+  if (!file.open(QIODevice::WriteOnly) || file.write(json) < 0 ||
+      !file.commit()) {
+    std::fprintf(stderr, "cannot write %s\n",
+                 qPrintable(parser.value("output")));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// Plays local files through file:// and mmap:// at a high speed, and
+// compares media throughput and CPU time of both stream implementations.
+//
+// MpvPlayerStreamBench --speed 16 --seconds 30 archive/*.mkv
+#include <algorithm>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <QtCore/QtCore>
+#include <MpvPlayer.hpp>
+#include "bench_util.hpp"
+
+namespace {
+struct Result {
+  double wall_seconds = 0;
+  double cpu_seconds = 0;
+  double media_seconds = 0;
+  double bytes = 0;
+};
+
+Result run(const QStringList& files, const QString& scheme, double speed,
+           int seconds) {
+  MpvPlayerOptions options = MpvPlayerOptions::defaults();
+  options.set("vo", "null");
+  options.set("ao", "null");
+  options.set("speed", speed);
+
+  QEventLoop loop;
+  QList<MpvPlayerObject*> players;
+  QSet<MpvPlayer*> ended;
+  for (int i = 0; i < files.size(); ++i) {
+    auto* player = new MpvPlayerObject(options, QString::number(i));
+    player->observePlayerProperty("time-pos");
+    QObject::connect(
+        player, &MpvPlayerObject::playStateChanged, &loop,
+        [&, player](int state) {
+          if (state == MpvPlayer::EndReached) {
+            ended.insert(player);
+            if (ended.size() == players.size()) {
+              loop.quit();
+            }
+          }
+        },
+        Qt::QueuedConnection);
+    players << player;
+  }
+
+  Result result;
+  double cpu = cpuSeconds();
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < files.size(); ++i) {
+    QUrl url = QUrl::fromLocalFile(QFileInfo(files[i]).absoluteFilePath());
+    url.setScheme(scheme);
+    players[i]->play(url);
+  }
+  QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+  loop.exec();
+  result.wall_seconds = timer.elapsed() / 1000.0;
+  result.cpu_seconds = cpuSeconds() - cpu;
+
+  for (int i = 0; i < files.size(); ++i) {
+    double duration = players[i]->observedPlayerProperty("duration").toDouble();
+    double position =
+        ended.contains(players[i])
+            ? duration
+            : players[i]->observedPlayerProperty("time-pos").toDouble();
+    result.media_seconds += position;
+    if (duration > 0) {
+      result.bytes += QFileInfo(files[i]).size() * position / duration;
+    }
+  }
+  qDeleteAll(players);
+  // Runs must not overlap with the teardown of the previous one
+  MpvPlayer::waitForTeardown();
+  return result;
+}
+
+void print(const QString& scheme, const Result& result) {
+  std::printf(
+      "%-8s %8.2f s wall %8.2f s cpu %10.1f media s %7.1fx %9.1f MiB/s "
+      "%7.3f cpu s per media min\n",
+      qPrintable(scheme), result.wall_seconds, result.cpu_seconds,
+      result.media_seconds,
+      result.media_seconds / std::max(result.wall_seconds, 0.001),
+      result.bytes / (1024 * 1024) / std::max(result.wall_seconds, 0.001),
+      result.media_seconds > 0
+          ? result.cpu_seconds * 60 / result.media_seconds
+          : 0.0);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // Qt sets the locale in the QCoreApplication constructor, but libmpv
+  // requires the LC_NUMERIC category to be set to "C", so change it back.
+  std::setlocale(LC_NUMERIC, "C");
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  parser.addOption(QCommandLineOption(QStringList() << "speed",
+                                      "Playback speed", "speed", "16"));
+  parser.addOption(QCommandLineOption(QStringList() << "seconds",
+                                      "Maximum seconds of a run", "seconds",
+                                      "30"));
+  parser.addOption(QCommandLineOption(
+      QStringList() << "rounds",
+      "Rounds of both protocols, in alternating order to even out the page "
+      "cache",
+      "rounds", "2"));
+  parser.addPositionalArgument("files", "Local video files", "files...");
+  parser.process(app);
+
+  QStringList files = parser.positionalArguments();
+  if (files.isEmpty()) {
+    parser.showHelp(EXIT_FAILURE);
+  }
+  double speed = parser.value("speed").toDouble();
+  int seconds = std::max(parser.value("seconds").toInt(), 1);
+  int rounds = std::max(parser.value("rounds").toInt(), 1);
+
+  QStringList schemes = {"file", "mmap"};
+  for (int round = 0; round < rounds; ++round) {
+    std::printf("round %d, %lld files at %.1fx\n", round + 1,
+                static_cast<long long>(files.size()), speed);
+    for (const QString& scheme : schemes) {
+      print(scheme, run(files, scheme, speed, seconds));
+    }
+    std::reverse(schemes.begin(), schemes.end());
+  }
+  return EXIT_SUCCESS;
+}
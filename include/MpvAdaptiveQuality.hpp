@@ -0,0 +1,63 @@
+#ifndef MPV_ADAPTIVE_QUALITY_HPP
+#define MPV_ADAPTIVE_QUALITY_HPP
+
+#include "MpvPlayer.hpp"
+
+// Feedback controller degrading players while the host is overloaded.
+//
+// Samples frame-drop-count, decoder-frame-drop-count, vo-delayed-frame-count
+// and estimated-vf-fps of every live player. Players dropping or delaying
+// frames are stepped down one quality level at a time, worst first, down to
+// keyframe-only decoding below ThumbnailQuality. Once no player is
+// overloaded, degraded players step back up after recoverySamples() healthy
+// samples in a row, one player per sample.
+class MpvAdaptiveQuality : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvAdaptiveQuality(QObject* parent = nullptr);
+  ~MpvAdaptiveQuality() override;
+
+  bool isRunning() const;
+  Q_SLOT void start();
+  // Stop sampling and restore every degraded player
+  Q_SLOT void stop();
+
+  // Sampling interval in milliseconds, 1000 by default
+  int interval() const;
+  void setInterval(int msec);
+  // Dropped and delayed frames per second making a player overloaded, 2 by
+  // default
+  double dropRateThreshold() const;
+  void setDropRateThreshold(double frames_per_second);
+  // Ratio of estimated-vf-fps to container-fps below which the decoder is
+  // lagging, 0.75 by default
+  double decodeLagRatio() const;
+  void setDecodeLagRatio(double ratio);
+  // Healthy samples in a row before a player steps back up, 5 by default
+  int recoverySamples() const;
+  void setRecoverySamples(int samples);
+
+  Q_SIGNAL void qualityDegraded(MpvPlayer* player, int steps);
+  Q_SIGNAL void qualityRestored(MpvPlayer* player, int steps);
+
+ private:
+  struct Sample {
+    qint64 time = 0;
+    qint64 dropped = 0;
+    // Samples left before the effect of the last step is measured
+    int cooldown = 0;
+    int healthy = 0;
+  };
+  void sample();
+  void step(MpvPlayer* player, int steps);
+
+  QHash<MpvPlayer*, Sample> samples_{};
+  double drop_rate_threshold_ = 2;
+  double decode_lag_ratio_ = 0.75;
+  int recovery_samples_ = 5;
+  QElapsedTimer clock_{};
+  QTimer timer_{};
+};
+
+#endif  // MPV_ADAPTIVE_QUALITY_HPP
@@ -0,0 +1,47 @@
+#ifndef MPV_METRICS_EXPORTER_HPP
+#define MPV_METRICS_EXPORTER_HPP
+
+#include "MpvPlayer.hpp"
+
+// Writes process-wide player metrics in the Prometheus text format every
+// interval(), for the textfile collector of node_exporter:
+// MpvMetricsExporter exporter(
+//     "/var/lib/node_exporter/textfile_collector/mpv.prom");
+// exporter.start();
+//
+// Exported are histograms of time to first frame, event dispatch time and
+// render time per frame, and counters of rendered and dropped frames, stream
+// reconnects and RTSP transport fallbacks, aggregated over every player.
+// Rendered frames are counted for the render API only, so the drop rate is
+// mpv_dropped_frames_total{renderer="api"} over mpv_rendered_frames_total.
+// The players record with atomic increments only, and time nothing until an
+// exporter started. The file is replaced atomically.
+class MpvMetricsExporter : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvMetricsExporter(const QString& path = "",
+                              QObject* parent = nullptr);
+  ~MpvMetricsExporter() override;
+
+  QString path() const;
+  void setPath(const QString& path);
+  // Milliseconds between writes, 15000 by default
+  int interval() const;
+  void setInterval(int msec);
+
+  bool isRunning() const;
+  Q_SLOT void start();
+  Q_SLOT void stop();
+
+  // Current metrics in the text exposition format
+  QByteArray metrics();
+  // Write the metrics to path() now
+  Q_SLOT bool write();
+
+ private:
+  QString path_;
+  QTimer timer_{};
+};
+
+#endif  // MPV_METRICS_EXPORTER_HPP
@@ -1,12 +1,18 @@
 #ifndef MPV_PLAYER_HPP
 #define MPV_PLAYER_HPP
 
+#include <array>
+#include <functional>
+
 #include <QtCore/QtCore>
 #include <QtGui/QtGui>
 #include <QtWidgets/QtWidgets>
 #include <QtQml/QtQml>
 #include <QtQuick/QtQuick>
 
+#include "MpvPlayerOptions.hpp"
+#include "MpvPlayerStats.hpp"
+
 struct mpv_handle;
 class MpvPlayer {
  public:
@@ -17,6 +23,131 @@ class MpvPlayer {
   // May increase performance, but with lower quality
   void enableHighPerformanceMode();
 
+  // Quality levels switchable at runtime without reloading. FullQuality keeps
+  // the options the player was constructed with, lower levels trade scaler,
+  // deblocking and frame rate for performance.
+  enum QualityLevel {
+    FullQuality,
+    BalancedQuality,
+    TileQuality,
+    ThumbnailQuality,
+    QualityLevelCount
+  };
+  QualityLevel qualityLevel() const;
+  void setQualityLevel(QualityLevel level);
+  // Levels below qualityLevel() applied while the host is overloaded, see
+  // MpvAdaptiveQuality. Limited to the levels left below qualityLevel(), plus
+  // keyframe-only decoding.
+  int qualityDegradation() const;
+  void setQualityDegradation(int steps);
+  int maxQualityDegradation() const;
+  // Level actually applied, including the degradation
+  QualityLevel effectiveQualityLevel() const;
+
+  // Maximum rendered frames per second, 0 for none. Frames beyond it are
+  // dropped by the VO before scaling and upload (video-sync=display-vdrop),
+  // without reinitializing filters and without touching source timing.
+  double maxFrameRate() const;
+  void setMaxFrameRate(double fps);
+  // Caps by surface height, applied as the player is resized. With
+  // {{270, 10}, {540, 15}}, players lower than 270 pixels are capped at 10 fps
+  // and players lower than 540 pixels at 15 fps.
+  QMap<int, double> heightFrameRates() const;
+  void setHeightFrameRates(const QMap<int, double>& rates);
+  // Cap actually applied, the lowest of maxFrameRate(), the height cap and the
+  // cap of the effective quality level, 0 for none
+  double frameRateCap() const;
+
+  // Decode keyframes only and repaint only when a new keyframe arrives, for
+  // overview grids and scrub previews. Also entered by degrading a player
+  // below ThumbnailQuality.
+  bool isKeyframeOnly() const;
+  void setKeyframeOnly(bool enabled);
+  // Options applied at construction
+  MpvPlayerOptions options() const;
+  // Decoder threads, 0 for mpv's automatic count. Managed by
+  // MpvResourceGovernor unless it is disabled.
+  int decoderThreads() const;
+  void setDecoderThreads(int threads);
+
+  // Transport of RTSP sources. RtspAuto starts each source over UDP and
+  // reconnects over TCP once lost packets and decoder errors within 10
+  // seconds reach rtspFallbackThreshold(). Defaults to the rtsp-transport
+  // option, or RtspAuto. Takes effect with the next load.
+  enum RtspTransport { RtspUdp, RtspTcp, RtspHttp, RtspAuto };
+  RtspTransport rtspTransport() const;
+  void setRtspTransport(RtspTransport transport);
+  // Transport of the current source, never RtspAuto
+  RtspTransport activeRtspTransport() const;
+  // Lost packets and decoder errors making RtspAuto fall back, 10 by default
+  int rtspFallbackThreshold() const;
+  void setRtspFallbackThreshold(int errors);
+  // RTP packets reported missing, decoder errors and fallbacks to TCP since
+  // construction
+  qint64 packetLossCount() const;
+  qint64 decodeErrorCount() const;
+  int transportFallbackCount() const;
+
+  // Kinds of sources with their own cache presets
+  enum SourceType { AutoSource, LiveSource, NetworkSource, LocalSource };
+  static SourceType sourceType(const QUrl& url);
+  // Demuxer cache of a player, applied before each load
+  struct CachePolicy {
+    // Presets of AutoSource follow the source type of each url, with the
+    // cache options the player was constructed with taking precedence. The
+    // other fields are then ignored.
+    SourceType source = AutoSource;
+    // cache, demuxer-max-bytes, demuxer-max-back-bytes and
+    // demuxer-readahead-secs
+    bool cache = true;
+    qint64 max_bytes = 0;
+    qint64 max_back_bytes = 0;
+    double readahead_seconds = 0;
+
+    static CachePolicy preset(SourceType source);
+  };
+  CachePolicy cachePolicy() const;
+  void setCachePolicy(const CachePolicy& policy);
+  // Limit of max_bytes plus max_back_bytes, 0 for none. Managed by
+  // MpvResourceGovernor unless it is disabled.
+  qint64 cacheLimit() const;
+  void setCacheLimit(qint64 bytes);
+  // Policy actually applied, with the preset of the source and the limit
+  CachePolicy effectiveCachePolicy() const;
+  // Latest demuxer-cache-state, with cache-duration, fw-bytes, total-bytes
+  // and seekable-ranges among others
+  QVariantMap cacheState() const;
+
+  // Keep the last seconds of a live source seekable in the back buffer, in
+  // memory or in a temporary file, so that it replays without touching the
+  // network. 0 turns time-shift off. The buffer is sized from the bitrate of
+  // the current source, 8 Mbit/s until it is known, grows with bitrate peaks,
+  // and is not limited by the cache budget.
+  double timeShiftSeconds() const;
+  void setTimeShift(double seconds, bool on_disk = false);
+  // Buffered range around the playback position, in seconds of the stream
+  double bufferedStart() const;
+  double bufferedEnd() const;
+  // Seek back by seconds within the buffered range
+  void replay(double seconds);
+  // Seek to the end of the buffered range
+  void goLive();
+
+  // Show live sources as soon as they arrive: frames are displayed untimed
+  // without audio sync, demuxer cache and probing are minimal, libavformat
+  // does not buffer (fflags=+nobuffer), and buffers are dropped to jump to
+  // the live edge whenever liveLatency() exceeds maxLiveLatency(). Cache and
+  // demuxer settings take effect with the next load.
+  bool isLowLatency() const;
+  void setLowLatency(bool enabled);
+  // Seconds behind the live edge tolerated in low-latency mode, 0.5 by
+  // default
+  double maxLiveLatency() const;
+  void setMaxLiveLatency(double seconds);
+  // Seconds between the newest demuxed packet and the playback position,
+  // the delay added by the player behind the live edge
+  double liveLatency() const;
+
   QString name() const;
   void setName(const QString& name);
   virtual void nameChanged(const QString& name);
@@ -33,17 +164,120 @@ class MpvPlayer {
   void setPaused(bool paused);
   virtual void pausedChanged(bool paused);
   void resume();
+  // Queued without waiting for the core
   void stop();
+  // Stop playback and restore every option changed through
+  // setPlayerProperty() to its value in options(), or to mpv's default, the
+  // name given at construction, and the defaults of quality, frame rate caps,
+  // cache policy, time-shift, low-latency mode, RTSP transport and stats, so
+  // the player can be reused for another source.
+  void reset();
+  // Handles of destroyed players are terminated on background threads. Block
+  // until all of them are gone, e.g. before the application exits. Returns
+  // false on timeout.
+  static bool waitForTeardown(int msec = -1);
+
+  // Creates the device of a url. Called on an mpv thread, the device is
+  // opened read-only unless already open, then read and deleted on that
+  // thread without an event loop.
+  //
+  // Supported are random-access devices such as QFile and QBuffer, sequential
+  // devices which block in waitForReadyRead() without an event loop such as
+  // QProcess, QTcpSocket and QLocalSocket, and sequential devices written
+  // from another thread. A sequential stream ends once the device is closed
+  // or emits readChannelFinished(), and reads stop when mpv cancels the
+  // stream. Devices which only receive data through the event loop of their
+  // thread, such as QNetworkReply, are not supported.
+  using StreamFactory = std::function<QIODevice*(const QUrl& url)>;
+  // Serve urls of the scheme from QIODevices in every player, through
+  // mpv_stream_cb_add_ro. Reads go straight into mpv's buffers, devices
+  // which are not sequential are seekable. Registering a scheme again
+  // replaces its factory. Call from the GUI thread, which owns the players.
+  static bool registerStreamProtocol(const QString& scheme,
+                                     const StreamFactory& factory);
+
+  // Playlist of the player, setUrl() replaces it with a single entry. Entries
+  // are prefetched, so consecutive files play without a stall.
+  void appendUrl(const QUrl& url);
+  // Appends when index is outside the playlist
+  void insertUrl(int index, const QUrl& url);
+  void removeUrl(int index);
+  // The entry ends up at index to
+  void moveUrl(int from, int to);
+  // Remove every entry but the current one
+  void clearPlaylist();
+  QList<QUrl> playlist() const;
+  virtual void playlistChanged();
+  // Index of the current entry, -1 if there is none
+  int playlistIndex() const;
+  void setPlaylistIndex(int index);
+  virtual void playlistIndexChanged(int index);
+
+  // Values of mpv_end_file_reason
+  enum EndReason {
+    EndOfFile = 0,
+    EndStopped = 2,
+    EndQuit = 3,
+    EndError = 4,
+    EndRedirect = 5
+  };
+  // An entry ended, error is only set for EndError. Playback reaches
+  // EndReached at the end of the last entry only.
+  virtual void fileEnded(int reason, const QString& error);
+  EndReason lastEndReason() const;
+  QString lastEndError() const;
 
   enum PlayState { Stop, Play, Pause, EndReached };
+  PlayState playState() const;
   virtual void playStateChanged(int state);
   virtual void durationChanged(double value);
   virtual void videoStarted();
   virtual void newLogMessage(int level, const QString& prefix,
                              const QString& msg);
 
+  // Startup phases of a load, in the order they are reached
+  enum StartupPhase {
+    Created,
+    Initialized,
+    LoadIssued,
+    FileStarted,
+    FileLoaded,
+    VideoReconfigured,
+    FirstFrame,
+    StartupPhaseCount
+  };
+  using StartupDurations = std::array<qint64, StartupPhaseCount>;
+  struct StartupTimeline {
+    QString name{};
+    QUrl url{};
+    // Monotonic timestamps in nanoseconds, 0 if the phase was not reached.
+    // Created and Initialized are only set for the first load of a player.
+    StartupDurations timestamps{};
+
+    // Nanoseconds since the previous reached phase, 0 if not reached
+    qint64 phaseDuration(StartupPhase phase) const;
+    // Nanoseconds from the first reached phase to the first rendered frame
+    qint64 timeToFirstFrame() const;
+  };
+  // Timeline of the last load which rendered its first frame. Players which
+  // mpv renders itself, MpvPlayerWidget and MpvPlayerObject without
+  // vo=libmpv, reach FirstFrame when playback starts after the video was
+  // configured.
+  StartupTimeline startupTimeline() const;
+  // Monotonic timestamp in nanoseconds of the last rendered frame, 0 before
+  // the first one. Players which mpv renders itself only stamp each start of
+  // playback.
+  qint64 lastFrameTime() const;
+  virtual void startupFinished(const MpvPlayer::StartupTimeline& timeline);
+
+  // Percentile in [0, 100] over recent loads of every player, in nanoseconds
+  static StartupDurations startupPhasePercentile(double percentile);
+  static qint64 timeToFirstFramePercentile(double percentile);
+
   QSize videoSize() const;
   QSize displaySize() const;
+  // Size of the widget or item the video is shown in
+  QSize surfaceSize() const;
   void setCropVideo(const QRect& rect);
   void setCropVideo(const QRectF& rect_ratio);
   void uncropVideo();
@@ -51,11 +285,26 @@ class MpvPlayer {
   template <typename... Args>
   QVariant playerCommand(Args&&... args);
   virtual QVariant command(const QVariant& args);
+  // Queue the command without waiting for the core to run it
+  template <typename... Args>
+  void playerCommandAsync(Args&&... args);
+  virtual void commandAsync(const QVariant& args);
 
   virtual bool setPlayerProperty(const QString& name, const QVariant& value);
   template <typename T>
   T getPlayerProperty(const QString& name) const;
 
+  // Observe the property from the event thread, so that its latest value can
+  // be read without a synchronous mpv call
+  void observePlayerProperty(const QString& name);
+  // Latest value of an observed property, invalid if not available
+  QVariant observedPlayerProperty(const QString& name) const;
+  // With the nanoseconds since it arrived, -1 if not available, to
+  // extrapolate continuous properties such as time-pos
+  QVariant observedPlayerProperty(const QString& name, qint64* age) const;
+  // Latest values of observed properties, read together
+  QVariantMap observedPlayerProperties(const QStringList& names) const;
+
  protected:
   void processQEvent(QEvent* event);
 
@@ -63,7 +312,9 @@ class MpvPlayer {
   friend class MpvPlayerWidget;
   friend class MpvPlayerOpenGLWidget;
   friend class MpvPlayerQuickObject;
-  explicit MpvPlayer(QObject* impl, const QString& name = "");
+  friend class MpvPlayerObject;
+  MpvPlayer(QObject* impl, const QString& name,
+            const MpvPlayerOptions& options);
 
   QVariant getPlayerProperty_(const QString& name) const;
 
@@ -80,6 +331,9 @@ class MpvPlayerWidget : public QWidget, public MpvPlayer {
  public:
   MpvPlayerWidget(const QString& name = "", QWidget* parent = nullptr,
                   Qt::WindowFlags f = Qt::WindowFlags());
+  explicit MpvPlayerWidget(const MpvPlayerOptions& options,
+                           const QString& name = "", QWidget* parent = nullptr,
+                           Qt::WindowFlags f = Qt::WindowFlags());
 
   Q_SIGNAL void nameChanged(const QString& name) override;
   Q_SIGNAL void urlChanged(const QUrl& url) override;
@@ -89,6 +343,11 @@ class MpvPlayerWidget : public QWidget, public MpvPlayer {
   Q_SIGNAL void videoStarted() override;
   Q_SIGNAL void newLogMessage(int level, const QString& prefix,
                               const QString& msg) override;
+  Q_SIGNAL void startupFinished(
+      const MpvPlayer::StartupTimeline& timeline) override;
+  Q_SIGNAL void playlistChanged() override;
+  Q_SIGNAL void playlistIndexChanged(int index) override;
+  Q_SIGNAL void fileEnded(int reason, const QString& error) override;
 
   Q_SLOT QVariant command(const QVariant& args) override {
     return MpvPlayer::command(args);
@@ -115,6 +374,10 @@ class MpvPlayerOpenGLWidget : public QOpenGLWidget, public MpvPlayer {
  public:
   MpvPlayerOpenGLWidget(const QString& name = "", QWidget* parent = nullptr,
                         Qt::WindowFlags f = Qt::WindowFlags());
+  explicit MpvPlayerOpenGLWidget(const MpvPlayerOptions& options,
+                                 const QString& name = "",
+                                 QWidget* parent = nullptr,
+                                 Qt::WindowFlags f = Qt::WindowFlags());
   ~MpvPlayerOpenGLWidget() override;
 
   Q_SIGNAL void nameChanged(const QString& name) override;
@@ -125,6 +388,11 @@ class MpvPlayerOpenGLWidget : public QOpenGLWidget, public MpvPlayer {
   Q_SIGNAL void videoStarted() override;
   Q_SIGNAL void newLogMessage(int level, const QString& prefix,
                               const QString& msg) override;
+  Q_SIGNAL void startupFinished(
+      const MpvPlayer::StartupTimeline& timeline) override;
+  Q_SIGNAL void playlistChanged() override;
+  Q_SIGNAL void playlistIndexChanged(int index) override;
+  Q_SIGNAL void fileEnded(int reason, const QString& error) override;
 
   Q_SLOT QVariant command(const QVariant& args) override {
     return MpvPlayer::command(args);
@@ -154,12 +422,18 @@ class MpvPlayerQuickObject : public QQuickFramebufferObject, public MpvPlayer {
   Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
   Q_PROPERTY(QUrl url READ url WRITE setUrl NOTIFY urlChanged)
   Q_PROPERTY(bool paused READ isPaused WRITE setPaused NOTIFY pausedChanged)
+  Q_PROPERTY(MpvPlayerStats* stats READ stats CONSTANT)
 
  public:
   MpvPlayerQuickObject(const QString& name = "", QQuickItem* parent = 0);
+  explicit MpvPlayerQuickObject(const MpvPlayerOptions& options,
+                                const QString& name = "",
+                                QQuickItem* parent = 0);
   ~MpvPlayerQuickObject() override;
 
   Renderer* createRenderer() const override;
+  // Updated once stats.interval is set
+  MpvPlayerStats* stats() const;
 
   Q_SIGNAL void nameChanged(const QString& name) override;
   Q_SIGNAL void urlChanged(const QUrl& url) override;
@@ -169,6 +443,11 @@ class MpvPlayerQuickObject : public QQuickFramebufferObject, public MpvPlayer {
   Q_SIGNAL void videoStarted() override;
   Q_SIGNAL void newLogMessage(int level, const QString& prefix,
                               const QString& msg) override;
+  Q_SIGNAL void startupFinished(
+      const MpvPlayer::StartupTimeline& timeline) override;
+  Q_SIGNAL void playlistChanged() override;
+  Q_SIGNAL void playlistIndexChanged(int index) override;
+  Q_SIGNAL void fileEnded(int reason, const QString& error) override;
 
   Q_SLOT QVariant command(const QVariant& args) override {
     return MpvPlayer::command(args);
@@ -183,8 +462,64 @@ class MpvPlayerQuickObject : public QQuickFramebufferObject, public MpvPlayer {
   struct MpvQuickRenderer;
   static void* get_proc_address(void* ctx, const char* name);
   MpvPlayer::Private* d;
+  MpvPlayerStats* stats_;
 };
 
+// Player without a surface, for audio, analysis and benchmarks. Video is
+// decoded to vo=null unless the options select another vo. With vo=libmpv,
+// frames are rendered into an image by the software renderer, without a GPU.
+class MpvPlayerObject : public QObject, public MpvPlayer {
+  Q_OBJECT
+  Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
+  Q_PROPERTY(QUrl url READ url WRITE setUrl NOTIFY urlChanged)
+  Q_PROPERTY(bool paused READ isPaused WRITE setPaused NOTIFY pausedChanged)
+
+ public:
+  MpvPlayerObject(const QString& name = "", QObject* parent = nullptr);
+  explicit MpvPlayerObject(const MpvPlayerOptions& options,
+                           const QString& name = "",
+                           QObject* parent = nullptr);
+  ~MpvPlayerObject() override;
+
+  // Size of rendered frames with vo=libmpv, 640x360 by default
+  QSize renderSize() const;
+  void setRenderSize(const QSize& size);
+  QImage lastFrame() const;
+  Q_SIGNAL void frameReady(const QImage& frame);
+
+  Q_SIGNAL void nameChanged(const QString& name) override;
+  Q_SIGNAL void urlChanged(const QUrl& url) override;
+  Q_SIGNAL void pausedChanged(bool paused) override;
+  Q_SIGNAL void playStateChanged(int state) override;
+  Q_SIGNAL void durationChanged(double value) override;
+  Q_SIGNAL void videoStarted() override;
+  Q_SIGNAL void newLogMessage(int level, const QString& prefix,
+                              const QString& msg) override;
+  Q_SIGNAL void startupFinished(
+      const MpvPlayer::StartupTimeline& timeline) override;
+  Q_SIGNAL void playlistChanged() override;
+  Q_SIGNAL void playlistIndexChanged(int index) override;
+  Q_SIGNAL void fileEnded(int reason, const QString& error) override;
+
+  Q_SLOT QVariant command(const QVariant& args) override {
+    return MpvPlayer::command(args);
+  }
+  Q_SLOT bool setPlayerProperty(const QString& name,
+                                const QVariant& value) override {
+    return MpvPlayer::setPlayerProperty(name, value);
+  }
+
+ private:
+  friend class MpvPlayer;
+  void renderFrame();
+
+  MpvPlayer::Private* d;
+  QSize render_size_{640, 360};
+  QImage frame_{};
+};
+
+Q_DECLARE_METATYPE(MpvPlayer::StartupTimeline)
+
 namespace {
 template <typename T>
 inline QVariantList& pack_args(QVariantList& params, T&& arg) {
@@ -205,6 +540,12 @@ inline QVariant MpvPlayer::playerCommand(Args&&... args) {
   return command(pack_args(params, std::forward<Args>(args)...));
 }
 
+template <typename... Args>
+inline void MpvPlayer::playerCommandAsync(Args&&... args) {
+  QVariantList params;
+  commandAsync(pack_args(params, std::forward<Args>(args)...));
+}
+
 template <typename T>
 inline T MpvPlayer::getPlayerProperty(const QString& name) const {
   return getPlayerProperty_(name).value<T>();
@@ -0,0 +1,58 @@
+#ifndef MPV_PLAYER_OPTIONS_HPP
+#define MPV_PLAYER_OPTIONS_HPP
+
+#include <QtCore/QtCore>
+
+// A profile of mpv options, applied in one batch before mpv_initialize().
+//
+// Profiles are either built in, or loaded from a file. JSON files map profile
+// names to objects of options, INI files use one group per profile. Every
+// profile extends "default", or the built-in profile or profile of the same
+// file named by its "base" key:
+// {
+//   "site-a": { "base": "wall-tile", "hwdec": "d3d11va-copy" }
+// }
+class MpvPlayerOptions {
+ public:
+  MpvPlayerOptions() = default;
+  explicit MpvPlayerOptions(const QVariantMap& options,
+                            const QString& name = "");
+
+  // "default", "low-latency-live", "vod-quality" and "wall-tile"
+  static QStringList builtinProfiles();
+  static MpvPlayerOptions builtinProfile(const QString& name,
+                                         bool* ok = nullptr);
+  // Load a profile from a JSON or INI file, an empty profile name loads the
+  // options at the top level of the file
+  static MpvPlayerOptions fromFile(const QString& path,
+                                   const QString& profile = "",
+                                   bool* ok = nullptr);
+
+  // Options of players constructed without explicit options, "default" if
+  // never set
+  static MpvPlayerOptions defaults();
+  static void setDefaults(const MpvPlayerOptions& options);
+
+  QString name() const;
+  void setName(const QString& name);
+
+  bool isEmpty() const;
+  bool contains(const QString& option) const;
+  QVariant value(const QString& option) const;
+  MpvPlayerOptions& set(const QString& option, const QVariant& value);
+  MpvPlayerOptions& remove(const QString& option);
+  QVariantMap options() const;
+
+  // Options of other override ours
+  MpvPlayerOptions& merge(const MpvPlayerOptions& other);
+
+  // Option name and value strings for mpv_set_option_string(), mpv's own
+  // "profile" option comes first so that the other options override it
+  QList<QPair<QByteArray, QByteArray>> toMpvOptions() const;
+
+ private:
+  QString name_{};
+  QVariantMap options_{};
+};
+
+#endif  // MPV_PLAYER_OPTIONS_HPP
@@ -0,0 +1,61 @@
+#ifndef MPV_PLAYER_POOL_HPP
+#define MPV_PLAYER_POOL_HPP
+
+#include <functional>
+
+#include "MpvPlayer.hpp"
+
+// Keeps initialized players warm, so that a layout switch reuses them instead
+// of paying for mpv_create()/mpv_initialize() and mpv_terminate_destroy().
+//
+// MpvPlayerPool pool([] { return new MpvPlayerOpenGLWidget; }, 36);
+// pool.prewarm(36);
+// MpvPlayer* player = pool.acquire("camera-1");
+// ...
+// pool.release(player);
+class MpvPlayerPool : public QObject {
+  Q_OBJECT
+
+ public:
+  using Factory = std::function<MpvPlayer*()>;
+
+  explicit MpvPlayerPool(const Factory& factory, int capacity = 16,
+                         QObject* parent = nullptr);
+  ~MpvPlayerPool() override;
+
+  // Maximum count of idle players kept, released players beyond it are
+  // destroyed
+  int capacity() const;
+  void setCapacity(int capacity);
+  int idleCount() const;
+
+  // Take an idle player, or create a new one if the pool is empty
+  MpvPlayer* acquire(const QString& name = "");
+  // Reset the player and keep it for reuse, the player is hidden but keeps its
+  // parent, so render contexts stay alive. Idle players get no share of the
+  // MpvResourceGovernor budgets, and leave the pool when they are destroyed
+  // elsewhere, e.g. with their parent.
+  void release(MpvPlayer* player);
+
+  // Create idle players until count is reached, synchronously
+  void reserve(int count);
+  // Create idle players until count is reached, one per event loop iteration,
+  // so that the burst does not block the GUI
+  void prewarm(int count);
+
+ private:
+  MpvPlayer* create();
+  void keep(MpvPlayer* player);
+  MpvPlayer* take();
+  void destroy(MpvPlayer* player);
+  void prewarmNext();
+
+  Factory factory_;
+  int capacity_ = 0;
+  int prewarm_target_ = 0;
+  QList<MpvPlayer*> idle_{};
+  // Players whose destruction removes them from idle_
+  QSet<MpvPlayer*> watched_{};
+};
+
+#endif  // MPV_PLAYER_POOL_HPP
@@ -0,0 +1,86 @@
+#ifndef MPV_PLAYER_STATS_HPP
+#define MPV_PLAYER_STATS_HPP
+
+#include <QtCore/QtCore>
+
+class MpvPlayer;
+
+// Performance telemetry of a player, refreshed every interval() milliseconds
+// from observed properties, so reading it costs no synchronous mpv call. The
+// properties are observed once an interval is set, 0 disables updates.
+//
+// MpvPlayerQuickObject exposes its stats as a property group:
+// MpvPlayerQuickObject {
+//   id: player
+//   stats.interval: 1000
+//   Text { text: player.stats.fps.toFixed(1) + " fps" }
+// }
+class MpvPlayerStats : public QObject {
+  Q_OBJECT
+  Q_PROPERTY(
+      int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+  Q_PROPERTY(double fps READ fps NOTIFY updated)
+  Q_PROPERTY(qint64 droppedFrames READ droppedFrames NOTIFY updated)
+  Q_PROPERTY(qint64 delayedFrames READ delayedFrames NOTIFY updated)
+  Q_PROPERTY(double videoBitrate READ videoBitrate NOTIFY updated)
+  Q_PROPERTY(double audioBitrate READ audioBitrate NOTIFY updated)
+  Q_PROPERTY(double cacheDuration READ cacheDuration NOTIFY updated)
+  Q_PROPERTY(qint64 cacheBytes READ cacheBytes NOTIFY updated)
+  Q_PROPERTY(QString decoder READ decoder NOTIFY updated)
+  Q_PROPERTY(QString hwdec READ hwdec NOTIFY updated)
+  Q_PROPERTY(double avSync READ avSync NOTIFY updated)
+
+ public:
+  struct Snapshot {
+    // Frame rate out of the video filters
+    double fps = 0;
+    // Frames dropped by the decoder and the VO, and frames the VO showed
+    // late, counted since the file was loaded
+    qint64 dropped_frames = 0;
+    qint64 delayed_frames = 0;
+    // Bits per second
+    double video_bitrate = 0;
+    double audio_bitrate = 0;
+    // Demuxed ahead of the playback position
+    double cache_duration = 0;
+    qint64 cache_bytes = 0;
+    QString decoder{};
+    // Hardware decoding API in use, empty for software decoding
+    QString hwdec{};
+    // Seconds the audio is ahead of the video
+    double av_sync = 0;
+  };
+  static void observe(MpvPlayer* player);
+  // Latest observed values, 0 for properties which are not observed
+  static Snapshot capture(const MpvPlayer* player);
+
+  explicit MpvPlayerStats(MpvPlayer* player, QObject* parent = nullptr);
+  ~MpvPlayerStats() override;
+
+  int interval() const;
+  void setInterval(int msec);
+
+  Snapshot snapshot() const;
+  double fps() const;
+  qint64 droppedFrames() const;
+  qint64 delayedFrames() const;
+  double videoBitrate() const;
+  double audioBitrate() const;
+  double cacheDuration() const;
+  qint64 cacheBytes() const;
+  QString decoder() const;
+  QString hwdec() const;
+  double avSync() const;
+
+  Q_SLOT void update();
+
+  Q_SIGNAL void updated();
+  Q_SIGNAL void intervalChanged(int msec);
+
+ private:
+  MpvPlayer* player_;
+  Snapshot snapshot_{};
+  QTimer timer_{};
+};
+
+#endif  // MPV_PLAYER_STATS_HPP
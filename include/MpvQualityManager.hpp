@@ -0,0 +1,52 @@
+#ifndef MPV_QUALITY_MANAGER_HPP
+#define MPV_QUALITY_MANAGER_HPP
+
+#include "MpvPlayer.hpp"
+
+// Promotes and demotes players between quality levels by focus and size.
+//
+// The focused player, and players at least fullQualityHeight() high, get
+// FullQuality. Smaller players step down to BalancedQuality, TileQuality and
+// ThumbnailQuality by their surface height.
+class MpvQualityManager : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvQualityManager(QObject* parent = nullptr);
+  ~MpvQualityManager() override;
+
+  void addPlayer(MpvPlayer* player);
+  void removePlayer(MpvPlayer* player);
+  QList<MpvPlayer*> players() const;
+
+  MpvPlayer* focusedPlayer() const;
+  void setFocusedPlayer(MpvPlayer* player);
+
+  // Minimum surface heights in pixels of each level, 720, 360 and 160 by
+  // default. Smaller players get ThumbnailQuality.
+  int fullQualityHeight() const;
+  int balancedQualityHeight() const;
+  int tileQualityHeight() const;
+  void setHeightThresholds(int full, int balanced, int tile);
+
+  MpvPlayer::QualityLevel qualityLevelFor(MpvPlayer* player) const;
+  // Apply the level of every player now
+  Q_SLOT void update();
+
+  Q_SIGNAL void qualityLevelChanged(MpvPlayer* player, int level);
+
+ protected:
+  bool eventFilter(QObject* watched, QEvent* event) override;
+
+ private:
+  void scheduleUpdate();
+
+  QList<MpvPlayer*> players_{};
+  MpvPlayer* focused_player_ = nullptr;
+  int full_height_ = 720;
+  int balanced_height_ = 360;
+  int tile_height_ = 160;
+  bool update_pending_ = false;
+};
+
+#endif  // MPV_QUALITY_MANAGER_HPP
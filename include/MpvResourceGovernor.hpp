@@ -0,0 +1,72 @@
+#ifndef MPV_RESOURCE_GOVERNOR_HPP
+#define MPV_RESOURCE_GOVERNOR_HPP
+
+#include "MpvPlayer.hpp"
+
+// Process-wide governor of resources shared by every live MpvPlayer.
+//
+// Decoder threads: each mpv instance would size its own decoder thread pool
+// from the core count, the governor instead splits a global budget between
+// live players by their surface area, and gives the focused player a bigger
+// share. Players are registered at construction, and the budget is
+// rebalanced shortly after players come and go or get resized.
+//
+// Demuxer cache: a process-wide memory budget is split evenly between live
+// players, and caps the cache policy of each one.
+//
+// Idle players, e.g. kept by MpvPlayerPool, have no source and get no share
+// of either budget until they are active again.
+//
+// Players come and go on the GUI thread, the governor is only used there.
+class MpvResourceGovernor : public QObject {
+  Q_OBJECT
+
+ public:
+  static MpvResourceGovernor* instance();
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  // Total decoder threads of all players, QThread::idealThreadCount() by
+  // default. Each player gets at least one.
+  int threadBudget() const;
+  void setThreadBudget(int threads);
+
+  // Total demuxer cache bytes of all players, 1 GiB by default, 0 for no
+  // limit
+  qint64 cacheBudget() const;
+  void setCacheBudget(qint64 bytes);
+
+  // Share of the focused player relative to an average tile
+  double focusWeight() const;
+  void setFocusWeight(double weight);
+  MpvPlayer* focusedPlayer() const;
+  void setFocusedPlayer(MpvPlayer* player);
+
+  // Every live player, idle ones included
+  QList<MpvPlayer*> players() const;
+  bool isPlayerIdle(MpvPlayer* player) const;
+  void setPlayerIdle(MpvPlayer* player, bool idle);
+
+  // Recompute the share of every player now
+  void rebalance();
+
+ private:
+  friend class MpvPlayer;
+  MpvResourceGovernor();
+  void addPlayer(MpvPlayer* player);
+  void removePlayer(MpvPlayer* player);
+  void playerResized(MpvPlayer* player);
+  void scheduleRebalance();
+
+  bool enabled_ = true;
+  int thread_budget_ = 0;
+  qint64 cache_budget_ = qint64(1024) * 1024 * 1024;
+  double focus_weight_ = 4.0;
+  MpvPlayer* focused_player_ = nullptr;
+  QList<MpvPlayer*> players_{};
+  QSet<MpvPlayer*> idle_players_{};
+  QTimer rebalance_timer_{};
+};
+
+#endif  // MPV_RESOURCE_GOVERNOR_HPP
@@ -0,0 +1,89 @@
+#ifndef MPV_STREAM_WATCHDOG_HPP
+#define MPV_STREAM_WATCHDOG_HPP
+
+#include "MpvPlayer.hpp"
+
+// Reconnects live players whose stream stalled.
+//
+// With network-timeout=0 a silently dead source never ends, the player stays
+// in Play and shows its last frame. The watchdog samples every live player
+// loading or playing a url. Playback progresses while frames are rendered,
+// time-pos moves or the demuxer cache grows. A player without progress for
+// stallTimeout(), or whose file ended with an error, is stalled and its
+// current entry is reloaded, without touching the rest of a playlist.
+// Attempts back off exponentially up to
+// maxReconnectDelay(), with a random jitter, so sources lost together do not
+// reconnect in lockstep.
+class MpvStreamWatchdog : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvStreamWatchdog(QObject* parent = nullptr);
+  ~MpvStreamWatchdog() override;
+
+  bool isRunning() const;
+  Q_SLOT void start();
+  Q_SLOT void stop();
+
+  // Sampling interval in milliseconds, 1000 by default
+  int interval() const;
+  void setInterval(int msec);
+  // Milliseconds without progress before a player is stalled, 5000 by default
+  int stallTimeout() const;
+  void setStallTimeout(int msec);
+  // Delay in milliseconds after the first reconnect, doubled by each attempt,
+  // 1000 by default. An attempt is given stallTimeout() at least.
+  int reconnectDelay() const;
+  void setReconnectDelay(int msec);
+  // 60000 by default
+  int maxReconnectDelay() const;
+  void setMaxReconnectDelay(int msec);
+  // Delays vary randomly by this ratio, 0.3 by default. First attempts are
+  // spread over jitter() * reconnectDelay().
+  double jitter() const;
+  void setJitter(double ratio);
+
+  bool isStalled(MpvPlayer* player) const;
+  int reconnectCount() const;
+
+  // msec is the time without progress when the stall was detected
+  Q_SIGNAL void stalled(MpvPlayer* player, qint64 msec);
+  Q_SIGNAL void reconnecting(MpvPlayer* player, int attempt);
+  // msec is the duration of the stall. A stall also ends when the player is
+  // paused, stopped or reset.
+  Q_SIGNAL void recovered(MpvPlayer* player, qint64 msec);
+
+ private:
+  struct Watch {
+    // Lost with the player, also when a new player reuses its address
+    QMetaObject::Connection file_ended{};
+    // Progress markers of the previous sample
+    qint64 frame_time = 0;
+    QVariant position{};
+    QVariant cache_end{};
+    qint64 progress_time = 0;
+    // Last known playlist entry, the position is lost when it fails
+    int playlist_index = -1;
+    // Start of the stall, -1 while healthy
+    qint64 stall_time = -1;
+    int attempts = 0;
+    qint64 next_attempt = 0;
+  };
+  void sample();
+  bool progressed(MpvPlayer* player, Watch& watch) const;
+  void reconnect(MpvPlayer* player, Watch& watch, qint64 now);
+  Q_SLOT void onFileEnded(int reason, const QString& error);
+
+  QHash<MpvPlayer*, Watch> watches_{};
+  // Senders of errors since the last sample, never dereferenced
+  QSet<QObject*> errors_{};
+  int stall_timeout_ = 5000;
+  int reconnect_delay_ = 1000;
+  int max_reconnect_delay_ = 60000;
+  double jitter_ = 0.3;
+  int reconnect_count_ = 0;
+  QElapsedTimer clock_{};
+  QTimer timer_{};
+};
+
+#endif  // MPV_STREAM_WATCHDOG_HPP
@@ -0,0 +1,86 @@
+#ifndef MPV_SYNC_GROUP_HPP
+#define MPV_SYNC_GROUP_HPP
+
+#include "MpvPlayer.hpp"
+
+// Plays several players on the clock of a master player.
+//
+// The time-pos of every member is observed and extrapolated from its arrival
+// to a common time, small drifts are corrected with speed adjustments, large
+// ones with a seek. start() pre-rolls all members at
+// a common position and resumes them together once every member is ready.
+class MpvSyncGroup : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvSyncGroup(QObject* parent = nullptr);
+  ~MpvSyncGroup() override;
+
+  // The member is at master position + offset, for recordings which started
+  // at different times. The first member is the master.
+  void addPlayer(MpvPlayer* player, double offset = 0);
+  // The member gets back the speed it had when it was added
+  void removePlayer(MpvPlayer* player);
+  QList<MpvPlayer*> players() const;
+  MpvPlayer* master() const;
+  void setMaster(MpvPlayer* player);
+
+  // Drift in seconds tolerated without correction, 0.04 by default
+  double tolerance() const;
+  void setTolerance(double seconds);
+  // Drift in seconds corrected with a seek instead of speed, 1 by default
+  double seekThreshold() const;
+  void setSeekThreshold(double seconds);
+  // Maximum relative speed change of a correction, 0.05 by default
+  double maxSpeedCorrection() const;
+  void setMaxSpeedCorrection(double ratio);
+  // Interval of drift measurement in milliseconds, 200 by default
+  int interval() const;
+  void setInterval(int msec);
+
+  // Position of the master
+  double position() const;
+  double speed() const;
+  bool isPaused() const;
+
+  Q_SLOT void play();
+  Q_SLOT void pause();
+  Q_SLOT void seek(double position);
+  Q_SLOT void setSpeed(double speed);
+  // Pause every member at position, and resume them together once all are
+  // ready
+  Q_SLOT void start(double position = 0);
+
+  Q_SIGNAL void started();
+  // A member drifted beyond the seek threshold and was seeked back
+  Q_SIGNAL void resynchronized(MpvPlayer* player, double drift);
+
+ private:
+  struct Member {
+    MpvPlayer* player = nullptr;
+    double offset = 0;
+    double speed = 1;
+    double initial_speed = 1;
+  };
+  Member* member(MpvPlayer* player);
+  // Remove a member without touching it
+  void forget(MpvPlayer* player);
+  void seekMember(Member& member, double position);
+  void setMemberSpeed(Member& member, double speed);
+  void synchronize();
+  void finishStart();
+
+  QList<Member> members_{};
+  MpvPlayer* master_ = nullptr;
+  double tolerance_ = 0.04;
+  double seek_threshold_ = 1.0;
+  double max_speed_correction_ = 0.05;
+  double speed_ = 1.0;
+  bool paused_ = true;
+  bool starting_ = false;
+  double start_position_ = 0;
+  QElapsedTimer start_timer_{};
+  QTimer timer_{};
+};
+
+#endif  // MPV_SYNC_GROUP_HPP
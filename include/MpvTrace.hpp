@@ -0,0 +1,78 @@
+#ifndef MPV_TRACE_HPP
+#define MPV_TRACE_HPP
+
+#include <atomic>
+
+#include <QtCore/QtCore>
+
+// Opt-in timeline of spans in the Chrome trace event format, to be opened in
+// Perfetto or chrome://tracing:
+// MpvTrace::start();
+// ...
+// MpvTrace::stop();
+// MpvTrace::write("wall.json");
+//
+// Players record commands, property reads and writes, the handling of each
+// event type, renders and render update requests. Each thread records into
+// its own buffer without locks, a full buffer drops further spans. While no
+// capture runs, a span costs a single branch.
+class MpvTrace {
+ public:
+  // Starts a new capture, dropping the previous one
+  static void start(int spans_per_thread = 65536);
+  static void stop();
+  static bool isRunning() { return running_.load(std::memory_order_relaxed); }
+  // Write the last capture as Chrome trace JSON
+  static bool write(const QString& path);
+  // Spans of the last capture lost to full buffers
+  static qint64 droppedSpans();
+  // Name of the calling thread in the trace
+  static void setThreadName(const QString& name);
+
+  // Records its lifetime. The name must outlive the capture, e.g. be a
+  // literal, the detail is copied and truncated.
+  class Span {
+   public:
+    explicit Span(const char* name) {
+      if (isRunning()) {
+        begin(name);
+      }
+    }
+    Span(const char* name, const QString& detail) {
+      if (isRunning()) {
+        begin(name);
+        setDetail(detail.toUtf8().constData());
+      }
+    }
+    // The first argument of a command
+    Span(const char* name, const QVariant& command) {
+      if (isRunning()) {
+        begin(name);
+        setCommand(command);
+      }
+    }
+    ~Span() {
+      if (begin_ != 0) {
+        end();
+      }
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    void setDetail(const char* detail);
+
+   private:
+    void begin(const char* name);
+    void setCommand(const QVariant& command);
+    void end();
+
+    const char* name_ = nullptr;
+    qint64 begin_ = 0;
+    char detail_[48];
+  };
+
+ private:
+  static inline std::atomic_bool running_{false};
+};
+
+#endif  // MPV_TRACE_HPP
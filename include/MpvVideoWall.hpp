@@ -0,0 +1,106 @@
+#ifndef MPV_VIDEO_WALL_HPP
+#define MPV_VIDEO_WALL_HPP
+
+#include "MpvPlayerPool.hpp"
+
+// qmlRegisterType<MpvVideoWall>("MpvPlayer", 1, 0, "MpvVideoWall");
+//
+// A grid of sources which only binds players to the cells in the viewport.
+// Players are taken from a pool, cells within warmRows() around the viewport
+// keep their source loaded but paused and hidden for instant scroll-in, and
+// players of every other cell are released back to the pool.
+//
+// Sources are urls, or maps and objects with "url", "name" and "paused"
+// properties. Visible cells of paused sources stay paused, and changes of
+// the "paused" property of objects apply at once. Scroll by binding contentY, e.g. to a Flickable with the same
+// contentHeight.
+class MpvVideoWall : public QQuickItem {
+  Q_OBJECT
+  Q_PROPERTY(QVariant sources READ sources WRITE setSources NOTIFY
+                 sourcesChanged)
+  Q_PROPERTY(int columns READ columns WRITE setColumns NOTIFY columnsChanged)
+  Q_PROPERTY(int rows READ rows WRITE setRows NOTIFY rowsChanged)
+  Q_PROPERTY(qreal contentY READ contentY WRITE setContentY NOTIFY
+                 contentYChanged)
+  Q_PROPERTY(qreal contentHeight READ contentHeight NOTIFY
+                 contentHeightChanged)
+  Q_PROPERTY(int warmRows READ warmRows WRITE setWarmRows NOTIFY
+                 warmRowsChanged)
+  Q_PROPERTY(int poolCapacity READ poolCapacity WRITE setPoolCapacity NOTIFY
+                 poolCapacityChanged)
+
+ public:
+  explicit MpvVideoWall(QQuickItem* parent = nullptr);
+  ~MpvVideoWall() override;
+
+  QVariant sources() const;
+  void setSources(const QVariant& sources);
+  Q_SIGNAL void sourcesChanged();
+
+  // Columns of the grid, 0 for a square grid of all sources
+  int columns() const;
+  void setColumns(int columns);
+  Q_SIGNAL void columnsChanged();
+
+  // Rows in the viewport, 0 to fit every row
+  int rows() const;
+  void setRows(int rows);
+  Q_SIGNAL void rowsChanged();
+
+  qreal contentY() const;
+  void setContentY(qreal y);
+  Q_SIGNAL void contentYChanged();
+
+  qreal contentHeight() const;
+  Q_SIGNAL void contentHeightChanged();
+
+  // Rows above and below the viewport whose players are kept loaded
+  int warmRows() const;
+  void setWarmRows(int rows);
+  Q_SIGNAL void warmRowsChanged();
+
+  // Idle players kept for reuse
+  int poolCapacity() const;
+  void setPoolCapacity(int capacity);
+  Q_SIGNAL void poolCapacityChanged();
+
+  // Player bound to the cell of the source, nullptr if the cell is neither
+  // visible nor warm
+  Q_INVOKABLE QObject* playerAt(int index) const;
+
+ protected:
+  void updatePolish() override;
+
+ private:
+  struct Source {
+    QUrl url{};
+    QString name{};
+    bool paused = false;
+    QPointer<QObject> object{};
+  };
+  struct Cell {
+    MpvPlayerQuickObject* player = nullptr;
+    bool paused = false;
+  };
+  bool isSourcePaused(int index) const;
+  Q_SLOT void sourcePausedChanged();
+  int columnCount() const;
+  int rowCount() const;
+  qreal cellHeight() const;
+  void setContentHeight(qreal height);
+  void releaseAll();
+
+  QVariant sources_{};
+  QVector<Source> source_list_{};
+  // Notifications of the "paused" property of object sources
+  QList<QMetaObject::Connection> source_connections_{};
+  int columns_ = 0;
+  int rows_ = 0;
+  qreal content_y_ = 0;
+  qreal content_height_ = 0;
+  int warm_rows_ = 1;
+  MpvPlayerPool pool_;
+  QHash<int, Cell> cells_{};
+};
+
+#endif  // MPV_VIDEO_WALL_HPP
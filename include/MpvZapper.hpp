@@ -0,0 +1,77 @@
+#ifndef MPV_ZAPPER_HPP
+#define MPV_ZAPPER_HPP
+
+#include "MpvPlayerPool.hpp"
+
+// Switches a monitor through a tour of sources without a cold start.
+//
+// The sources around the current one in the tour are kept connected in
+// candidate players, muted with a small cache, BalancedQuality and 2 frames
+// per second. Candidates decode every frame, at the decoding cost of a
+// playing source, since changing decoder options on a switch would
+// reinitialize the decoder and wait for the next keyframe. They stay visible
+// below the current player, so their render contexts exist and a recent
+// frame is ready. A switch raises the candidate and restores its quality and
+// frame rate, the previous player becomes a candidate or goes back to the
+// pool.
+//
+// Players of the factory must overlap, e.g. share a QGridLayout cell:
+// MpvZapper zapper([layout] {
+//   auto* player = new MpvPlayerOpenGLWidget;
+//   layout->addWidget(player, 0, 0);
+//   return player;
+// });
+// zapper.setUrls(cameras);
+// zapper.next();
+class MpvZapper : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit MpvZapper(const MpvPlayerPool::Factory& factory,
+                     QObject* parent = nullptr);
+  ~MpvZapper() override;
+
+  QList<QUrl> urls() const;
+  void setUrls(const QList<QUrl>& urls);
+
+  // Sources kept connected around the current one, alternating next and
+  // previous, 2 by default
+  int prebufferCount() const;
+  void setPrebufferCount(int count);
+
+  int currentIndex() const;
+  Q_SLOT void setCurrentIndex(int index);
+  Q_SLOT void next();
+  Q_SLOT void previous();
+  MpvPlayer* currentPlayer() const;
+  bool isPrebuffered(int index) const;
+
+  Q_SIGNAL void currentIndexChanged(int index);
+  Q_SIGNAL void currentPlayerChanged(MpvPlayer* player);
+
+ private:
+  QList<int> candidateIndexes() const;
+  MpvPlayer* load(int index);
+  void demote(MpvPlayer* player, const QUrl& url);
+  void promote(MpvPlayer* player);
+  void updateCandidates();
+  void release(MpvPlayer* player);
+  void releaseAll();
+
+  MpvPlayerPool pool_;
+  QList<QUrl> urls_{};
+  int prebuffer_count_ = 2;
+  int current_index_ = -1;
+  MpvPlayer* current_player_ = nullptr;
+  QHash<int, MpvPlayer*> candidates_{};
+  // Settings changed by demote(), restored by promote()
+  struct SavedState {
+    MpvPlayer::CachePolicy cache_policy{};
+    MpvPlayer::QualityLevel quality_level = MpvPlayer::FullQuality;
+    double max_frame_rate = 0;
+    QVariantMap properties{};
+  };
+  QHash<MpvPlayer*, SavedState> saved_states_{};
+};
+
+#endif  // MPV_ZAPPER_HPP
@@ -4,6 +4,8 @@
 #include <QtWidgets/QtWidgets>
 #include <QtQuickWidgets/QtQuickWidgets>
 #include <MpvPlayer.hpp>
+#include <MpvTrace.hpp>
+#include <MpvVideoWall.hpp>
 
 MpvPlayerQuickInput::MpvPlayerQuickInput(const QString& name, const QUrl& url,
                                          bool paused)
@@ -69,6 +71,16 @@ int main(int argc, char* argv[]) {
       QStringList() << "p"
                     << "performance-mode",
       "Performance mode, disable some features to improve performance"));
+  parser.addOption(QCommandLineOption(
+      QStringList() << "profile",
+      "Option profile of players, built-in or from --options-file",
+      "profile"));
+  parser.addOption(
+      QCommandLineOption(QStringList() << "options-file",
+                         "JSON or INI file of option profiles", "file"));
+  parser.addOption(QCommandLineOption(
+      QStringList() << "trace",
+      "Write a Chrome trace of the players to file on exit", "file"));
   parser.addPositionalArgument("url", "Video urls", "urls...");
   parser.process(app);
 
@@ -103,8 +115,26 @@ int main(int argc, char* argv[]) {
     parser.showHelp(EXIT_FAILURE);
   }
 
+  if (parser.isSet("options-file")) {
+    bool ok = false;
+    MpvPlayerOptions options = MpvPlayerOptions::fromFile(
+        parser.value("options-file"), parser.value("profile"), &ok);
+    if (!ok) {
+      qWarning() << "Failed to load options from"
+                 << parser.value("options-file");
+    }
+    MpvPlayerOptions::setDefaults(options);
+  } else if (parser.isSet("profile")) {
+    MpvPlayerOptions::setDefaults(
+        MpvPlayerOptions::builtinProfile(parser.value("profile")));
+  }
+
   qmlRegisterType<MpvPlayerQuickObject>("MpvPlayer", 1, 0,
                                         "MpvPlayerQuickObject");
+  qmlRegisterType<MpvVideoWall>("MpvPlayer", 1, 0, "MpvVideoWall");
+  qmlRegisterUncreatableType<MpvPlayerStats>("MpvPlayer", 1, 0,
+                                             "MpvPlayerStats",
+                                             "Stats belong to a player");
 
   QWidget* window;
   QGridLayout* layout;
@@ -181,5 +211,13 @@ int main(int argc, char* argv[]) {
                                               QVariant::fromValue(playerList));
   }
 
-  return app.exec();
+  if (parser.isSet("trace")) {
+    MpvTrace::start();
+  }
+  int ret = app.exec();
+  if (parser.isSet("trace")) {
+    MpvTrace::stop();
+    MpvTrace::write(parser.value("trace"));
+  }
+  return ret;
 }
@@ -6,25 +6,22 @@ Item {
     width: 1280
     height: 720
 
-    GridView {
-        id: grid
+    MpvVideoWall {
+        id: wall
 
         anchors.fill: parent
-        focus: true
 
-        property int columns: Math.sqrt(count) > 1 ? Math.ceil(Math.sqrt(count)) : 1
-        cellWidth: width / columns
-        cellHeight: height / Math.ceil(count / columns)
+        sources: players
+        contentY: flickable.contentY
+    }
+
+    Flickable {
+        id: flickable
 
-        model: players
-        delegate: MpvPlayerQuickObject {
-            id: player
-            width: grid.cellWidth
-            height: grid.cellHeight
+        anchors.fill: parent
+        focus: true
 
-            name: model.name
-            url: model.url
-            paused: model.paused
-        }
+        contentWidth: width
+        contentHeight: wall.contentHeight
     }
 }
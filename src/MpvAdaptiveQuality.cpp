@@ -0,0 +1,188 @@
+#include "MpvAdaptiveQuality.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "MpvResourceGovernor.hpp"
+
+namespace {
+const char* const kObservedProperties[] = {
+    "frame-drop-count", "decoder-frame-drop-count", "vo-delayed-frame-count",
+    "estimated-vf-fps", "container-fps"};
+// Samples skipped after a step, while the decoder settles
+constexpr int kCooldownSamples = 2;
+
+qint64 observedCount(MpvPlayer* player, const char* name) {
+  return player->observedPlayerProperty(name).toLongLong();
+}
+
+qint64 droppedFrames(MpvPlayer* player) {
+  qint64 dropped = observedCount(player, "decoder-frame-drop-count") +
+                   observedCount(player, "vo-delayed-frame-count");
+  // A frame rate cap drops frames in the VO on purpose
+  if (player->frameRateCap() == 0) {
+    dropped += observedCount(player, "frame-drop-count");
+  }
+  return dropped;
+}
+}  // namespace
+
+MpvAdaptiveQuality::MpvAdaptiveQuality(QObject* parent) : QObject(parent) {
+  timer_.setInterval(1000);
+  connect(&timer_, &QTimer::timeout, this, &MpvAdaptiveQuality::sample);
+}
+
+MpvAdaptiveQuality::~MpvAdaptiveQuality() { stop(); }
+
+bool MpvAdaptiveQuality::isRunning() const { return timer_.isActive(); }
+
+void MpvAdaptiveQuality::start() {
+  if (!timer_.isActive()) {
+    clock_.start();
+    timer_.start();
+  }
+}
+
+void MpvAdaptiveQuality::stop() {
+  timer_.stop();
+  QList<MpvPlayer*> players = MpvResourceGovernor::instance()->players();
+  for (auto it = samples_.cbegin(); it != samples_.cend(); ++it) {
+    if (players.contains(it.key()) && it.key()->qualityDegradation() > 0) {
+      it.key()->setQualityDegradation(0);
+      emit qualityRestored(it.key(), 0);
+    }
+  }
+  samples_.clear();
+}
+
+int MpvAdaptiveQuality::interval() const { return timer_.interval(); }
+
+void MpvAdaptiveQuality::setInterval(int msec) { timer_.setInterval(msec); }
+
+double MpvAdaptiveQuality::dropRateThreshold() const {
+  return drop_rate_threshold_;
+}
+
+void MpvAdaptiveQuality::setDropRateThreshold(double frames_per_second) {
+  drop_rate_threshold_ = std::max(frames_per_second, 0.0);
+}
+
+double MpvAdaptiveQuality::decodeLagRatio() const { return decode_lag_ratio_; }
+
+void MpvAdaptiveQuality::setDecodeLagRatio(double ratio) {
+  decode_lag_ratio_ = std::clamp(ratio, 0.0, 1.0);
+}
+
+int MpvAdaptiveQuality::recoverySamples() const { return recovery_samples_; }
+
+void MpvAdaptiveQuality::setRecoverySamples(int samples) {
+  recovery_samples_ = std::max(samples, 1);
+}
+
+void MpvAdaptiveQuality::sample() {
+  qint64 now = clock_.elapsed();
+  QList<MpvPlayer*> players = MpvResourceGovernor::instance()->players();
+
+  // Forget destroyed players, without touching them
+  for (auto it = samples_.begin(); it != samples_.end();) {
+    it = players.contains(it.key()) ? std::next(it) : samples_.erase(it);
+  }
+
+  struct Load {
+    MpvPlayer* player;
+    double drop_rate;
+  };
+  std::vector<Load> overloaded;
+  for (MpvPlayer* player : players) {
+    auto it = samples_.find(player);
+    if (it == samples_.end()) {
+      for (const char* name : kObservedProperties) {
+        player->observePlayerProperty(name);
+      }
+      it = samples_.insert(player, Sample{});
+      it->time = now;
+      it->dropped = droppedFrames(player);
+      continue;
+    }
+
+    Sample& sample = *it;
+    qint64 dropped = droppedFrames(player);
+    double seconds = (now - sample.time) / 1000.0;
+    // Counters restart with each file
+    double drop_rate = seconds > 0 && dropped >= sample.dropped
+                           ? (dropped - sample.dropped) / seconds
+                           : 0;
+    sample.time = now;
+    sample.dropped = dropped;
+    if (player->playState() != MpvPlayer::Play) {
+      continue;
+    }
+    if (sample.cooldown > 0) {
+      --sample.cooldown;
+      continue;
+    }
+
+    double vf_fps =
+        player->observedPlayerProperty("estimated-vf-fps").toDouble();
+    double container_fps =
+        player->observedPlayerProperty("container-fps").toDouble();
+    // Keyframe-only decoding lowers the frame rate on purpose
+    bool lagging = !player->isKeyframeOnly() && vf_fps > 0 &&
+                   container_fps > 0 &&
+                   vf_fps < container_fps * decode_lag_ratio_;
+
+    if (drop_rate > drop_rate_threshold_ || lagging) {
+      sample.healthy = 0;
+      overloaded.push_back(
+          {player, drop_rate + (lagging ? drop_rate_threshold_ : 0)});
+    } else {
+      ++sample.healthy;
+    }
+  }
+
+  if (!overloaded.empty()) {
+    // Relieve the host gradually, worst players first
+    std::sort(overloaded.begin(), overloaded.end(),
+              [](const Load& a, const Load& b) {
+                return a.drop_rate > b.drop_rate;
+              });
+    size_t count = std::max<size_t>(players.size() / 8, 1);
+    for (const Load& load : overloaded) {
+      if (count == 0) {
+        break;
+      }
+      if (load.player->qualityDegradation() <
+          load.player->maxQualityDegradation()) {
+        step(load.player, 1);
+        --count;
+      }
+    }
+    return;
+  }
+
+  // Headroom, restore the player which has been healthy the longest
+  MpvPlayer* candidate = nullptr;
+  int healthy = recovery_samples_ - 1;
+  for (auto it = samples_.cbegin(); it != samples_.cend(); ++it) {
+    if (it.key()->qualityDegradation() > 0 && it->healthy > healthy) {
+      candidate = it.key();
+      healthy = it->healthy;
+    }
+  }
+  if (candidate) {
+    step(candidate, -1);
+  }
+}
+
+void MpvAdaptiveQuality::step(MpvPlayer* player, int steps) {
+  player->setQualityDegradation(player->qualityDegradation() + steps);
+  Sample& sample = samples_[player];
+  sample.cooldown = kCooldownSamples;
+  sample.healthy = 0;
+  if (steps > 0) {
+    emit qualityDegraded(player, player->qualityDegradation());
+  } else {
+    emit qualityRestored(player, player->qualityDegradation());
+  }
+}
@@ -0,0 +1,96 @@
+#include "MpvMappedFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // Q_OS_UNIX
+
+namespace {
+// Readahead requested beyond the read position
+constexpr qint64 kReadaheadBytes = 16 * 1024 * 1024;
+}  // namespace
+
+MpvMappedFile::MpvMappedFile(const QString& path, QObject* parent)
+    : QIODevice(parent), file_(path) {}
+
+MpvMappedFile::~MpvMappedFile() { close(); }
+
+QString MpvMappedFile::localPath(const QUrl& url) {
+  QUrl file_url = url;
+  file_url.setScheme("file");
+  return file_url.toLocalFile();
+}
+
+bool MpvMappedFile::open(OpenMode mode) {
+  if ((mode & WriteOnly) || !file_.open(QIODevice::ReadOnly)) {
+    setErrorString(file_.errorString());
+    return false;
+  }
+  size_ = file_.size();
+  if (size_ > 0) {
+    data_ = file_.map(0, size_);
+    if (!data_) {
+      setErrorString(file_.errorString());
+      file_.close();
+      return false;
+    }
+#ifdef Q_OS_UNIX
+    madvise(data_, size_, MADV_SEQUENTIAL);
+#endif  // Q_OS_UNIX
+  }
+  advised_ = 0;
+  adviseReadahead(0);
+  // Reads are copies out of the mapping already, skip the QIODevice buffer
+  return QIODevice::open(ReadOnly | Unbuffered);
+}
+
+void MpvMappedFile::close() {
+  if (data_) {
+    file_.unmap(data_);
+    data_ = nullptr;
+  }
+  file_.close();
+  size_ = 0;
+  QIODevice::close();
+}
+
+bool MpvMappedFile::isSequential() const { return false; }
+
+qint64 MpvMappedFile::size() const { return size_; }
+
+qint64 MpvMappedFile::readData(char* data, qint64 max_size) {
+  qint64 position = pos();
+  qint64 size = std::min(max_size, size_ - position);
+  if (size <= 0) {
+    return 0;
+  }
+  adviseReadahead(position + size);
+  std::memcpy(data, data_ + position, size);
+  return size;
+}
+
+qint64 MpvMappedFile::writeData(const char*, qint64) { return -1; }
+
+void MpvMappedFile::adviseReadahead(qint64 position) {
+#ifdef Q_OS_UNIX
+  // Advise in steps of half the window, and again after a seek
+  bool in_window = position >= advised_ - kReadaheadBytes &&
+                   (position <= advised_ - kReadaheadBytes / 2 ||
+                    advised_ == size_);
+  if (!data_ || in_window) {
+    return;
+  }
+  static const qint64 page_size = sysconf(_SC_PAGESIZE);
+  qint64 begin = position / page_size * page_size;
+  qint64 end = std::min(position + kReadaheadBytes, size_);
+  if (end > begin) {
+    madvise(data_ + begin, end - begin, MADV_WILLNEED);
+  }
+  advised_ = end;
+#else
+  Q_UNUSED(position)
+#endif  // Q_OS_UNIX
+}
@@ -0,0 +1,36 @@
+#ifndef MPV_MAPPED_FILE_HPP
+#define MPV_MAPPED_FILE_HPP
+
+#include <QtCore/QtCore>
+
+// Read-only device over a memory-mapped file, behind the built-in mmap://
+// stream protocol. Reads are copies out of the mapping instead of read()
+// syscalls, and the kernel is advised to read ahead of the position.
+class MpvMappedFile : public QIODevice {
+ public:
+  explicit MpvMappedFile(const QString& path, QObject* parent = nullptr);
+  ~MpvMappedFile() override;
+
+  // Path of an mmap:// url, mmap:///C:/video.mp4 on Windows
+  static QString localPath(const QUrl& url);
+
+  bool open(OpenMode mode) override;
+  void close() override;
+  bool isSequential() const override;
+  qint64 size() const override;
+
+ protected:
+  qint64 readData(char* data, qint64 max_size) override;
+  qint64 writeData(const char* data, qint64 max_size) override;
+
+ private:
+  void adviseReadahead(qint64 position);
+
+  QFile file_;
+  uchar* data_ = nullptr;
+  qint64 size_ = 0;
+  // End of the range already advised to be read ahead
+  qint64 advised_ = 0;
+};
+
+#endif  // MPV_MAPPED_FILE_HPP
@@ -0,0 +1,87 @@
+#include "MpvMetrics.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+void writeCounter(QTextStream& out, const char* name, const char* help,
+                  quint64 value) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << " counter\n"
+      << name << ' ' << value << '\n';
+}
+}  // namespace
+
+MpvMetrics::Histogram::Histogram(std::initializer_list<double> bounds)
+    : counts_(bounds.size() + 1) {
+  for (double bound : bounds) {
+    bounds_.push_back(qint64(bound * 1e9));
+  }
+}
+
+void MpvMetrics::Histogram::observe(qint64 nanoseconds) {
+  auto bucket = std::lower_bound(bounds_.cbegin(), bounds_.cend(), nanoseconds);
+  counts_[std::distance(bounds_.cbegin(), bucket)].fetch_add(
+      1, std::memory_order_relaxed);
+  sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void MpvMetrics::Histogram::write(QTextStream& out, const char* name,
+                                  const char* help) const {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << " histogram\n";
+  // Buckets are cumulative, the count is their total so that both agree
+  // while observations go on
+  quint64 count = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    count += counts_[i].load(std::memory_order_relaxed);
+    out << name << "_bucket{le=\"";
+    if (i < bounds_.size()) {
+      out << bounds_[i] / 1e9;
+    } else {
+      out << "+Inf";
+    }
+    out << "\"} " << count << '\n';
+  }
+  out << name << "_sum " << sum_.load(std::memory_order_relaxed) / 1e9 << '\n'
+      << name << "_count " << count << '\n';
+}
+
+MpvMetrics& MpvMetrics::instance() {
+  static MpvMetrics metrics;
+  return metrics;
+}
+
+QByteArray MpvMetrics::toPrometheus(int players) const {
+  QByteArray text;
+  QTextStream out(&text);
+  out << "# HELP mpv_players Live players\n"
+      << "# TYPE mpv_players gauge\n"
+      << "mpv_players " << players << '\n';
+  time_to_first_frame.write(out, "mpv_time_to_first_frame_seconds",
+                            "Time from a load to its first rendered frame");
+  event_dispatch.write(out, "mpv_event_dispatch_seconds",
+                       "Time to handle an mpv event in the event thread");
+  render_time.write(out, "mpv_render_seconds",
+                    "Time to render a frame with mpv_render_context_render");
+  writeCounter(out, "mpv_rendered_frames_total",
+               "Frames rendered through the render API",
+               rendered_frames.value());
+  // Rendered frames are unknown for native VO windows, so their drops are a
+  // series of their own
+  out << "# HELP mpv_dropped_frames_total Frames dropped by the decoders and "
+         "the VOs, by renderer\n"
+      << "# TYPE mpv_dropped_frames_total counter\n"
+      << "mpv_dropped_frames_total{renderer=\"api\"} "
+      << dropped_frames.value() << '\n'
+      << "mpv_dropped_frames_total{renderer=\"vo\"} "
+      << vo_dropped_frames.value() << '\n';
+  writeCounter(out, "mpv_reconnects_total",
+               "Reconnects of stalled streams by the watchdog",
+               reconnects.value());
+  writeCounter(out, "mpv_transport_fallbacks_total",
+               "Reconnects of RTSP streams from UDP to TCP",
+               transport_fallbacks.value());
+  out.flush();
+  return text;
+}
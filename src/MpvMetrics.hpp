@@ -0,0 +1,74 @@
+#ifndef MPV_METRICS_HPP
+#define MPV_METRICS_HPP
+
+#include <atomic>
+#include <initializer_list>
+#include <vector>
+
+#include <QtCore/QtCore>
+
+// Process-wide counters and histograms behind MpvMetricsExporter. Recording
+// is a relaxed atomic increment, without locks, and timing is skipped until
+// an exporter started.
+class MpvMetrics {
+ public:
+  class Counter {
+   public:
+    void add(quint64 value = 1) {
+      value_.fetch_add(value, std::memory_order_relaxed);
+    }
+    quint64 value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<quint64> value_{0};
+  };
+
+  // Durations in fixed buckets
+  class Histogram {
+   public:
+    // Upper bounds of the buckets in seconds, ascending
+    Histogram(std::initializer_list<double> bounds);
+
+    void observe(qint64 nanoseconds);
+    void write(QTextStream& out, const char* name, const char* help) const;
+
+   private:
+    std::vector<qint64> bounds_{};
+    // One more for durations above the last bound
+    std::vector<std::atomic<quint64>> counts_;
+    std::atomic<qint64> sum_{0};
+  };
+
+  // Per-file counters of each player summed into dropped_frames or
+  // vo_dropped_frames, observed once metrics are enabled
+  static constexpr const char* kDroppedFrameProperties[] = {
+      "frame-drop-count", "decoder-frame-drop-count"};
+
+  static MpvMetrics& instance();
+  static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+  // Text exposition format, version 0.0.4
+  QByteArray toPrometheus(int players) const;
+
+  Histogram time_to_first_frame{0.1, 0.25, 0.5, 1, 2, 4, 8, 16};
+  // Handling of one event by the event thread
+  Histogram event_dispatch{0.00001, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05};
+  // mpv_render_context_render() of one frame
+  Histogram render_time{0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066};
+  // Frames of players rendering through the render API, which are the only
+  // ones counted in rendered_frames
+  Counter rendered_frames{};
+  Counter dropped_frames{};
+  // Frames dropped by players with a native VO window
+  Counter vo_dropped_frames{};
+  Counter reconnects{};
+  Counter transport_fallbacks{};
+
+ private:
+  MpvMetrics() = default;
+
+  static inline std::atomic_bool enabled_{false};
+};
+
+#endif  // MPV_METRICS_HPP
@@ -0,0 +1,58 @@
+#include "MpvMetricsExporter.hpp"
+
+#include "MpvMetrics.hpp"
+#include "MpvResourceGovernor.hpp"
+
+MpvMetricsExporter::MpvMetricsExporter(const QString& path, QObject* parent)
+    : QObject(parent), path_(path) {
+  timer_.setInterval(15000);
+  connect(&timer_, &QTimer::timeout, this, &MpvMetricsExporter::write);
+}
+
+MpvMetricsExporter::~MpvMetricsExporter() = default;
+
+QString MpvMetricsExporter::path() const { return path_; }
+
+void MpvMetricsExporter::setPath(const QString& path) { path_ = path; }
+
+int MpvMetricsExporter::interval() const { return timer_.interval(); }
+
+void MpvMetricsExporter::setInterval(int msec) { timer_.setInterval(msec); }
+
+bool MpvMetricsExporter::isRunning() const { return timer_.isActive(); }
+
+void MpvMetricsExporter::start() {
+  MpvMetrics::enable();
+  // Players count dropped frames from these, new players observe them at
+  // construction
+  for (MpvPlayer* player : MpvResourceGovernor::instance()->players()) {
+    for (const char* name : MpvMetrics::kDroppedFrameProperties) {
+      player->observePlayerProperty(name);
+    }
+  }
+  if (!timer_.isActive()) {
+    timer_.start();
+    write();
+  }
+}
+
+void MpvMetricsExporter::stop() { timer_.stop(); }
+
+QByteArray MpvMetricsExporter::metrics() {
+  return MpvMetrics::instance().toPrometheus(
+      MpvResourceGovernor::instance()->players().size());
+}
+
+bool MpvMetricsExporter::write() {
+  if (path_.isEmpty()) {
+    return false;
+  }
+  // Scrapers never read a partial file
+  QSaveFile file(path_);
+  if (!file.open(QIODevice::WriteOnly) || file.write(metrics()) < 0 ||
+      !file.commit()) {
+    qWarning() << "Cannot write metrics to" << path_ << file.errorString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,21 @@
+#ifndef MPV_PERCENTILE_HPP
+#define MPV_PERCENTILE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Nearest-rank percentile of the values, a default value if there is none
+template <typename Container>
+typename Container::value_type percentileOf(Container values,
+                                            double percentile) {
+  if (values.empty()) {
+    return {};
+  }
+  std::sort(values.begin(), values.end());
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  auto rank = static_cast<size_t>(std::ceil(percentile / 100 * values.size()));
+  return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+#endif  // MPV_PERCENTILE_HPP
@@ -2,17 +2,31 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
 #include <mpv/render.h>
+#include <mpv/stream_cb.h>
 #include <qloggingcategory.h>
 #include <qnamespace.h>
 #include "libmpv_qthelper.hpp"
+#include "MpvMappedFile.hpp"
+#include "MpvMetrics.hpp"
+#include "MpvPercentile.hpp"
+#include "MpvResourceGovernor.hpp"
+#include "MpvTrace.hpp"
 
 #include <QtWidgets/QtWidgets>
 
@@ -58,6 +72,319 @@ namespace {
   } while (0)
 }  // namespace
 
+namespace {
+qint64 monotonicNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Startup timelines of recent loads of every player
+class StartupStatistics {
+ public:
+  static StartupStatistics& instance() {
+    static StartupStatistics statistics;
+    return statistics;
+  }
+
+  void record(const MpvPlayer::StartupTimeline& timeline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.push_back(timeline);
+    while (samples_.size() > kMaxSamples) {
+      samples_.pop_front();
+    }
+  }
+
+  template <typename Function>
+  qint64 percentile(double percentile, Function&& value) {
+    std::vector<qint64> values;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      values.reserve(samples_.size());
+      // Phases a load never reached are 0
+      for (const MpvPlayer::StartupTimeline& timeline : samples_) {
+        qint64 duration = value(timeline);
+        if (duration > 0) {
+          values.push_back(duration);
+        }
+      }
+    }
+    return percentileOf(std::move(values), percentile);
+  }
+
+ private:
+  static constexpr size_t kMaxSamples = 1024;
+  std::mutex mutex_;
+  std::deque<MpvPlayer::StartupTimeline> samples_;
+};
+// Terminates the handles of destroyed players on worker threads, since
+// stopping the demuxer and decoders of a hung source can take seconds
+class Reaper {
+ public:
+  // Leaked, so that handles of players destroyed during static destruction
+  // are still terminated
+  static Reaper& instance() {
+    static Reaper* reaper = new Reaper;
+    return *reaper;
+  }
+
+  void destroy(mpv_handle* mpv) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handles_.push_back(mpv);
+    ++pending_;
+    if (idle_workers_ == 0 && workers_ < kMaxWorkers) {
+      ++workers_;
+      std::thread([this] { run(); }).detach();
+    }
+    queued_.notify_one();
+  }
+
+  bool wait(int msec) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto done = [this] { return pending_ == 0; };
+    if (msec < 0) {
+      drained_.wait(lock, done);
+      return true;
+    }
+    return drained_.wait_for(lock, std::chrono::milliseconds(msec), done);
+  }
+
+ private:
+  // A hung source only holds up its own worker
+  static constexpr int kMaxWorkers = 4;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      ++idle_workers_;
+      queued_.wait(lock, [this] { return !handles_.empty(); });
+      --idle_workers_;
+      mpv_handle* mpv = handles_.front();
+      handles_.pop_front();
+      lock.unlock();
+      mpv_terminate_destroy(mpv);
+      lock.lock();
+      if (--pending_ == 0) {
+        drained_.notify_all();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::condition_variable drained_;
+  std::deque<mpv_handle*> handles_;
+  int pending_ = 0;
+  int workers_ = 0;
+  int idle_workers_ = 0;
+};
+}  // namespace
+
+namespace {
+// Stream protocols served from QIODevices, registered with every player
+class StreamProtocols {
+ public:
+  // Leaked, entries are the user data of mpv callbacks
+  static StreamProtocols& instance() {
+    static StreamProtocols* protocols = new StreamProtocols;
+    return *protocols;
+  }
+
+  StreamProtocols() {
+    // Local files read from a memory mapping, mmap:///path/to/file
+    entries_.insert("mmap", new Entry{{}, [](const QUrl& url) {
+                      return new MpvMappedFile(MpvMappedFile::localPath(url));
+                    }});
+  }
+
+  // Returns true if the scheme is new, players then have to add it
+  bool set(const QString& scheme, const MpvPlayer::StreamFactory& factory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(scheme);
+    if (it != entries_.end()) {
+      std::lock_guard<std::mutex> entry_lock((*it)->mutex);
+      (*it)->factory = factory;
+      return false;
+    }
+    entries_.insert(scheme, new Entry{{}, factory});
+    return true;
+  }
+
+  void addTo(mpv_handle* mpv, const QString& only_scheme = QString()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+      if (!only_scheme.isEmpty() && it.key() != only_scheme) {
+        continue;
+      }
+      int ret = mpv_stream_cb_add_ro(mpv, it.key().toUtf8().constData(),
+                                     it.value(), &StreamProtocols::open);
+      if (ret != MPV_ERROR_SUCCESS) {
+        qCWarning(MPV) << "Error adding stream protocol" << it.key() << ':'
+                       << mpv_error_string(ret);
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    std::mutex mutex;
+    MpvPlayer::StreamFactory factory;
+  };
+
+  // Called on an mpv thread for every url of the scheme
+  static int open(void* user_data, char* uri, mpv_stream_cb_info* info) {
+    auto* entry = static_cast<Entry*>(user_data);
+    MpvPlayer::StreamFactory factory;
+    {
+      std::lock_guard<std::mutex> lock(entry->mutex);
+      factory = entry->factory;
+    }
+    QIODevice* device =
+        factory ? factory(QUrl(QString::fromUtf8(uri))) : nullptr;
+    if (!device) {
+      return MPV_ERROR_LOADING_FAILED;
+    }
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+      qCWarning(MPV) << "Error opening stream" << uri << ':'
+                     << device->errorString();
+      delete device;
+      return MPV_ERROR_LOADING_FAILED;
+    }
+    auto* stream = new Stream;
+    stream->device.reset(device);
+    // Emitted on the thread writing the device, without an event loop here
+    QObject::connect(device, &QIODevice::readChannelFinished,
+                     [stream] { stream->finished = true; });
+    info->cookie = stream;
+    info->read_fn = &StreamProtocols::read;
+    // Sequential devices are not seekable and have no known size
+    info->seek_fn = device->isSequential() ? nullptr : &StreamProtocols::seek;
+    info->size_fn = &StreamProtocols::size;
+    info->close_fn = &StreamProtocols::close;
+    info->cancel_fn = &StreamProtocols::cancel;
+    return 0;
+  }
+
+  // Cookie of an open stream, the device is destroyed first
+  struct Stream {
+    std::atomic_bool cancelled{false};
+    std::atomic_bool finished{false};
+    std::unique_ptr<QIODevice> device;
+  };
+
+  static int64_t read(void* cookie, char* buf, uint64_t nbytes) {
+    // Longest wait for data between checks for cancellation
+    constexpr int kPollInterval = 50;
+    auto* stream = static_cast<Stream*>(cookie);
+    QIODevice* device = stream->device.get();
+    // Waits for data until the device is closed or finished, 0 is the end of
+    // the stream. Devices without a blocking waitForReadyRead() return at
+    // once and are polled.
+    QElapsedTimer timer;
+    while (device->isSequential() && device->bytesAvailable() == 0 &&
+           device->isOpen() && !stream->finished) {
+      if (stream->cancelled) {
+        return -1;
+      }
+      timer.start();
+      if (!device->waitForReadyRead(kPollInterval) &&
+          timer.elapsed() < kPollInterval / 5) {
+        QThread::msleep(kPollInterval / 5);
+      }
+    }
+    qint64 size = device->read(buf, static_cast<qint64>(nbytes));
+    return size < 0 ? -1 : size;
+  }
+
+  static int64_t seek(void* cookie, int64_t offset) {
+    QIODevice* device = static_cast<Stream*>(cookie)->device.get();
+    return device->seek(offset) ? offset : MPV_ERROR_GENERIC;
+  }
+
+  static int64_t size(void* cookie) {
+    QIODevice* device = static_cast<Stream*>(cookie)->device.get();
+    return device->isSequential() ? MPV_ERROR_UNSUPPORTED : device->size();
+  }
+
+  // Called from another thread when loading is aborted or the player is
+  // destroyed, a blocked read() returns an error
+  static void cancel(void* cookie) {
+    static_cast<Stream*>(cookie)->cancelled = true;
+  }
+
+  static void close(void* cookie) { delete static_cast<Stream*>(cookie); }
+
+  std::mutex mutex_;
+  QMap<QString, Entry*> entries_;
+};
+}  // namespace
+
+namespace {
+// Properties managed by quality levels
+const char* const kQualityProperties[] = {
+    "scale",
+    "dscale",
+    "cscale",
+    "framedrop",
+    "vd-lavc-fast",
+    "sws-fast",
+    "zimg-fast",
+    "vd-lavc-skiploopfilter",
+    "vd-lavc-skipframe",
+    "video-sync",
+    "override-display-fps",
+};
+
+QMap<QByteArray, QByteArray> qualitySettings(MpvPlayer::QualityLevel level) {
+  QMap<QByteArray, QByteArray> settings;
+  switch (level) {
+    case MpvPlayer::ThumbnailQuality:
+      settings["vd-lavc-skiploopfilter"] = "all";
+      settings["framedrop"] = "decoder+vo";
+      Q_FALLTHROUGH();
+    case MpvPlayer::TileQuality:
+      if (!settings.contains("vd-lavc-skiploopfilter")) {
+        settings["vd-lavc-skiploopfilter"] = "nonref";
+      }
+      settings["vd-lavc-fast"] = "yes";
+      settings["sws-fast"] = "yes";
+      settings["zimg-fast"] = "yes";
+      Q_FALLTHROUGH();
+    case MpvPlayer::BalancedQuality:
+      settings["scale"] = "bilinear";
+      settings["dscale"] = "bilinear";
+      settings["cscale"] = "bilinear";
+      if (!settings.contains("framedrop")) {
+        settings["framedrop"] = "vo";
+      }
+      break;
+    default:
+      break;
+  }
+  return settings;
+}
+
+// Options of a cache policy
+const char* const kCacheOptions[] = {"cache", "demuxer-max-bytes",
+                                     "demuxer-max-back-bytes",
+                                     "demuxer-readahead-secs"};
+// Properties only managed while time-shift is on
+const char* const kTimeShiftProperties[] = {
+    "demuxer-seekable-cache", "force-seekable", "cache-on-disk"};
+
+// Frame rate cap of each quality level, 0 for none
+double qualityFrameRate(MpvPlayer::QualityLevel level) {
+  switch (level) {
+    case MpvPlayer::TileQuality:
+      return 15;
+    case MpvPlayer::ThumbnailQuality:
+      return 5;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
 struct MpvPlayer::Private {
   Q_DISABLE_COPY(Private)
 
@@ -65,19 +392,429 @@ struct MpvPlayer::Private {
   explicit Private(MpvPlayer* q_ptr) : q(q_ptr) {}
 
   QObject* impl_ = nullptr;
+  MpvPlayerOptions options_{};
+  // Name given at construction, restored by reset()
+  QString initial_name_{};
   QString name_{};
   QUrl url_{};
-  PlayState state_ = Stop;
+  QSize surface_size_{};
+  void setSurfaceSize(const QSize& size);
+  int decoder_threads_ = 0;
+  std::atomic<RtspTransport> rtsp_transport_{RtspAuto};
+  std::atomic<RtspTransport> active_rtsp_transport_{RtspUdp};
+  std::atomic_int rtsp_fallback_threshold_ = ATOMIC_VAR_INIT(10);
+  std::atomic<qint64> packets_lost_{0};
+  std::atomic<qint64> decode_errors_{0};
+  std::atomic_int transport_fallbacks_ = ATOMIC_VAR_INIT(0);
+  // Errors of the current window, written by the event thread
+  qint64 error_window_start_ = 0;
+  qint64 error_window_errors_ = 0;
+  // Transport of the rtsp-transport option, RtspAuto by default
+  RtspTransport optionRtspTransport() const;
+  void applyRtspTransport();
+  void trackTransportErrors(const QString& prefix, const QString& text);
+  CachePolicy cache_policy_{};
+  // Cache options among the construction options, as parsed by mpv. They
+  // override the presets of AutoSource.
+  QVariantMap cache_options_{};
+  qint64 cache_limit_ = 0;
+  // Read by the event thread
+  std::atomic_bool low_latency_ = ATOMIC_VAR_INIT(false);
+  std::atomic<double> max_live_latency_{0.5};
+  qint64 last_live_skip_ = 0;
+  QVariantMap low_latency_baseline_{};
+  void skipToLiveEdge();
+  // Read by the event thread
+  std::atomic<double> time_shift_seconds_{0};
+  bool time_shift_on_disk_ = false;
+  qint64 time_shift_bytes_ = 0;
+  // Bitrate the buffer is sized for, 0 before it is known
+  double time_shift_bitrate_ = 0;
+  // Returns true if time_shift_bytes_ changed
+  bool sizeTimeShift(bool force);
+  // Values of kTimeShiftProperties before time-shift was turned on
+  QVariantMap time_shift_baseline_{};
+  // Seekable range containing the playback position
+  QPair<double, double> bufferedRange() const;
+  CachePolicy effectiveCachePolicy() const;
+  void applyCachePolicy();
+  std::atomic<PlayState> state_{Stop};
+
+  QualityLevel quality_level_ = FullQuality;
+  int quality_degradation_ = 0;
+  QualityLevel effectiveQualityLevel() const;
+  bool keyframe_only_ = false;
+  // Read by the render thread
+  std::atomic_bool keyframe_only_applied_ = ATOMIC_VAR_INIT(false);
+  bool keyframeOnly() const;
+  double max_frame_rate_ = 0;
+  QMap<int, double> height_frame_rates_{};
+  double heightFrameRate() const;
+  // Values of the quality properties at the first level change, and the
+  // values currently applied
+  QMap<QByteArray, QByteArray> quality_baseline_{};
+  QMap<QByteArray, QByteArray> quality_applied_{};
+  double frameRateCap() const;
+  void applyQuality();
   void changeState(PlayState state, bool resume = false);
 
   struct mpv_handle* mpv_ = nullptr;
   mpv_render_context* mpv_gl_ = nullptr;
 
+  // Names of properties set through setPlayerProperty() since the last
+  // reset(), which restores them from options_ or mpv's option defaults
+  QSet<QString> written_properties_{};
+
+  // Startup timestamps of the current load, stamped from the GUI, event and
+  // render threads
+  std::array<std::atomic<qint64>, StartupPhaseCount> startup_{};
+  mutable std::mutex startup_mutex_;
+  StartupTimeline startup_pending_{};
+  StartupTimeline startup_timeline_{};
+  void markStartup(StartupPhase phase);
+  void beginStartup();
+  // Called by the renderers before mpv_render_context_render(), whether a new
+  // frame has to be rendered at the given size
+  QSize rendered_size_{};
+  bool needsRender(const QSize& size);
+  // Called by the renderers after each mpv_render_context_render(), which
+  // started at render_start, or 0 when metrics are disabled
+  void frameRendered(qint64 render_start);
+  std::atomic<qint64> last_frame_time_{0};
+  // Frames go through the render API. Otherwise mpv presents them itself, to
+  // a window or no VO, and the start of playback stands in for the first one.
+  std::atomic_bool render_api_ = ATOMIC_VAR_INIT(false);
+  // Values of MpvMetrics::kDroppedFrameProperties in the current file, -1
+  // until known, written by the event thread
+  qint64 drop_counts_[std::size(MpvMetrics::kDroppedFrameProperties)] = {-1,
+                                                                        -1};
+  void countDroppedFrames(const char* name, const QVariant& value);
+
+  // Latest values of observed properties, written by the event thread
+  mutable std::mutex observed_mutex_;
+  QSet<QString> observed_names_{};
+  QHash<QString, QVariant> observed_properties_{};
+  // monotonicNanoseconds() of the arrival of each latest value
+  QHash<QString, qint64> observed_times_{};
+  // Whether the observed playlist position is its last entry. The playlist
+  // only moves on after END_FILE.
+  bool onLastEntry() const;
+
+  std::atomic<EndReason> last_end_reason_{EndStopped};
+  QString last_end_error_{};
+  // Argument of loadfile
+  static QString source(const QUrl& url);
+
   std::atomic_bool mpv_event_thread_running_ = ATOMIC_VAR_INIT(false);
   std::thread mpv_event_thread_{};
   void processMpvEvents();
 };
 
+QString MpvPlayer::Private::source(const QUrl& url) {
+  return url.isLocalFile() ? url.toLocalFile() : url.toString();
+}
+
+void MpvPlayer::Private::setSurfaceSize(const QSize& size) {
+  if (size != surface_size_) {
+    double fps = heightFrameRate();
+    surface_size_ = size;
+    if (heightFrameRate() != fps) {
+      applyQuality();
+    }
+    MpvResourceGovernor::instance()->playerResized(q);
+  }
+}
+
+MpvPlayer::QualityLevel MpvPlayer::Private::effectiveQualityLevel() const {
+  return QualityLevel(std::min<int>(quality_level_ + quality_degradation_,
+                                    QualityLevelCount - 1));
+}
+
+bool MpvPlayer::Private::keyframeOnly() const {
+  return keyframe_only_ ||
+         quality_level_ + quality_degradation_ >= QualityLevelCount;
+}
+
+double MpvPlayer::Private::heightFrameRate() const {
+  auto it = height_frame_rates_.upperBound(surface_size_.height());
+  return it != height_frame_rates_.cend() ? it.value() : 0;
+}
+
+double MpvPlayer::Private::frameRateCap() const {
+  if (keyframeOnly()) {
+    return 0;
+  }
+  double cap = 0;
+  for (double fps : {max_frame_rate_, heightFrameRate(),
+                     qualityFrameRate(effectiveQualityLevel())}) {
+    if (fps > 0 && (cap == 0 || fps < cap)) {
+      cap = fps;
+    }
+  }
+  return cap;
+}
+
+MpvPlayer::CachePolicy MpvPlayer::Private::effectiveCachePolicy() const {
+  CachePolicy policy = cache_policy_;
+  if (cache_policy_.source == AutoSource) {
+    policy = CachePolicy::preset(sourceType(url_));
+    // cache=auto is what the preset of each source type decides
+    QString cache = cache_options_.value("cache").toString();
+    if (cache == "yes" || cache == "no") {
+      policy.cache = cache == "yes";
+    }
+    if (cache_options_.contains("demuxer-max-bytes")) {
+      policy.max_bytes = cache_options_["demuxer-max-bytes"].toLongLong();
+    }
+    if (cache_options_.contains("demuxer-max-back-bytes")) {
+      policy.max_back_bytes =
+          cache_options_["demuxer-max-back-bytes"].toLongLong();
+    }
+    if (cache_options_.contains("demuxer-readahead-secs")) {
+      policy.readahead_seconds =
+          cache_options_["demuxer-readahead-secs"].toDouble();
+    }
+  }
+  // Scale forward and back buffer down together to the share of the player
+  qint64 total = policy.max_bytes + policy.max_back_bytes;
+  if (cache_limit_ > 0 && total > cache_limit_) {
+    double scale = double(cache_limit_) / total;
+    policy.max_bytes = static_cast<qint64>(policy.max_bytes * scale);
+    policy.max_back_bytes = static_cast<qint64>(policy.max_back_bytes * scale);
+  }
+  if (low_latency_) {
+    policy.cache = false;
+    policy.max_bytes = std::min<qint64>(policy.max_bytes, 2 * 1024 * 1024);
+    policy.max_back_bytes = 0;
+    policy.readahead_seconds = 0;
+  }
+  // An explicit request, outside of the budget
+  if (time_shift_seconds_ > 0) {
+    policy.cache = true;
+    policy.max_back_bytes = std::max(policy.max_back_bytes, time_shift_bytes_);
+  }
+  return policy;
+}
+
+void MpvPlayer::Private::applyCachePolicy() {
+  if (!mpv_) {
+    return;
+  }
+  CachePolicy policy = effectiveCachePolicy();
+  const std::pair<const char*, QByteArray> properties[] = {
+      {"cache", policy.cache ? "yes" : "no"},
+      {"demuxer-max-bytes", QByteArray::number(policy.max_bytes)},
+      {"demuxer-max-back-bytes", QByteArray::number(policy.max_back_bytes)},
+      {"demuxer-readahead-secs",
+       QByteArray::number(policy.readahead_seconds)},
+  };
+  for (const auto& property : properties) {
+    CHECK_MPV_ERROR(mpv_set_property_string(mpv_, property.first,
+                                            property.second.constData()));
+  }
+
+  if (time_shift_seconds_ > 0) {
+    if (time_shift_baseline_.isEmpty()) {
+      for (const char* name : kTimeShiftProperties) {
+        time_shift_baseline_.insert(
+            name, mpv::qt::get_property_variant(mpv_, name));
+      }
+    }
+    // Seeks within the cache never reach the source
+    const std::pair<const char*, const char*> time_shift[] = {
+        {"demuxer-seekable-cache", "yes"},
+        {"force-seekable", "yes"},
+        {"cache-on-disk", time_shift_on_disk_ ? "yes" : "no"},
+    };
+    for (const auto& property : time_shift) {
+      CHECK_MPV_ERROR(
+          mpv_set_property_string(mpv_, property.first, property.second));
+    }
+  } else {
+    QVariantMap baseline = std::exchange(time_shift_baseline_, {});
+    for (auto it = baseline.cbegin(); it != baseline.cend(); ++it) {
+      if (it.value().isValid()) {
+        CHECK_MPV_ERROR(
+            mpv::qt::set_property_variant(mpv_, it.key(), it.value()));
+      }
+    }
+  }
+}
+
+MpvPlayer::RtspTransport MpvPlayer::Private::optionRtspTransport() const {
+  QString transport = options_.value("rtsp-transport").toString();
+  if (transport == "udp") {
+    return RtspUdp;
+  } else if (transport == "tcp") {
+    return RtspTcp;
+  } else if (transport == "http") {
+    return RtspHttp;
+  } else {
+    return RtspAuto;
+  }
+}
+
+void MpvPlayer::Private::applyRtspTransport() {
+  static const char* const kTransports[] = {"udp", "tcp", "http", "udp"};
+  if (mpv_) {
+    CHECK_MPV_ERROR(mpv_set_property_string(
+        mpv_, "rtsp-transport", kTransports[active_rtsp_transport_.load()]));
+  }
+}
+
+void MpvPlayer::Private::trackTransportErrors(const QString& prefix,
+                                              const QString& text) {
+  // Reported by the RTP demuxer of ffmpeg
+  static const QRegularExpression missed_packets("missed (\\d+) packets");
+  constexpr qint64 kErrorWindow = 10000000000;
+
+  // Each lost packet weighs as much as a decoder error
+  qint64 errors = 1;
+  QRegularExpressionMatch match = missed_packets.match(text);
+  if (match.hasMatch()) {
+    errors = match.captured(1).toLongLong();
+    packets_lost_ += errors;
+  } else if (prefix.startsWith("ffmpeg/video") &&
+             (text.contains("error", Qt::CaseInsensitive) ||
+              text.contains("concealing") || text.contains("corrupt"))) {
+    ++decode_errors_;
+  } else {
+    return;
+  }
+  if (rtsp_transport_ != RtspAuto || active_rtsp_transport_ != RtspUdp) {
+    return;
+  }
+
+  qint64 now = monotonicNanoseconds();
+  if (now - error_window_start_ > kErrorWindow) {
+    error_window_start_ = now;
+    error_window_errors_ = 0;
+  }
+  error_window_errors_ += errors;
+  if (error_window_errors_ < rtsp_fallback_threshold_) {
+    return;
+  }
+  error_window_errors_ = 0;
+  // The url belongs to the GUI thread, reconnect there
+  QMetaObject::invokeMethod(
+      impl_,
+      [this] {
+        if (active_rtsp_transport_ != RtspUdp ||
+            !url_.scheme().startsWith("rtsp", Qt::CaseInsensitive)) {
+          return;
+        }
+        active_rtsp_transport_ = RtspTcp;
+        ++transport_fallbacks_;
+        MpvMetrics::instance().transport_fallbacks.add();
+        MpvPWarning() << "Reconnecting over TCP after "
+                      << rtsp_fallback_threshold_ << " errors";
+        q->setUrl(url_);
+      },
+      Qt::QueuedConnection);
+}
+
+void MpvPlayer::Private::skipToLiveEdge() {
+  // Give the decoder time to catch up after each skip
+  constexpr qint64 kSkipInterval = 2000000000;
+  if (!low_latency_.load(std::memory_order_acquire)) {
+    return;
+  }
+  double latency = q->liveLatency();
+  qint64 now = monotonicNanoseconds();
+  if (latency <= max_live_latency_.load(std::memory_order_acquire) ||
+      now - last_live_skip_ < kSkipInterval) {
+    return;
+  }
+  last_live_skip_ = now;
+  MpvPDebug() << "Dropping buffers " << latency << "s behind the live edge";
+  const char* args[] = {"drop-buffers", nullptr};
+  CHECK_MPV_ERROR(mpv_command_async(mpv_, 0, args));
+}
+
+bool MpvPlayer::Private::sizeTimeShift(bool force) {
+  // Bits per second of the current source, 8 Mbit/s until known
+  constexpr double kDefaultBitrate = 8000000;
+  double bitrate = q->observedPlayerProperty("video-bitrate").toDouble() +
+                   q->observedPlayerProperty("audio-bitrate").toDouble();
+  // Once sized for a known bitrate, only peaks well above it grow the buffer
+  if (!force && (bitrate <= 0 || (time_shift_bitrate_ > 0 &&
+                                  bitrate < time_shift_bitrate_ * 1.25))) {
+    return false;
+  }
+  time_shift_bitrate_ = std::max(bitrate, 0.0);
+  // With headroom for bitrate peaks
+  time_shift_bytes_ = static_cast<qint64>(
+      time_shift_seconds_ * (bitrate > 0 ? bitrate : kDefaultBitrate) / 8 *
+      1.5);
+  return true;
+}
+
+QPair<double, double> MpvPlayer::Private::bufferedRange() const {
+  QVariantList ranges = q->cacheState().value("seekable-ranges").toList();
+  double position = q->observedPlayerProperty("time-pos").toDouble();
+  QPair<double, double> range{0, 0};
+  for (const QVariant& value : ranges) {
+    QVariantMap map = value.toMap();
+    range = {map.value("start").toDouble(), map.value("end").toDouble()};
+    if (position >= range.first && position <= range.second) {
+      break;
+    }
+  }
+  return range;
+}
+
+void MpvPlayer::Private::applyQuality() {
+  if (!mpv_) {
+    return;
+  }
+  if (quality_baseline_.isEmpty()) {
+    for (const char* name : kQualityProperties) {
+      char* value = mpv_get_property_string(mpv_, name);
+      quality_baseline_[name] = value ? QByteArray(value) : QByteArray();
+      mpv_free(value);
+    }
+    quality_applied_ = quality_baseline_;
+  }
+
+  QMap<QByteArray, QByteArray> settings = quality_baseline_;
+  QMap<QByteArray, QByteArray> level =
+      qualitySettings(effectiveQualityLevel());
+  for (auto it = level.cbegin(); it != level.cend(); ++it) {
+    settings[it.key()] = it.value();
+  }
+  // Only keyframes reach the VO, none of them may be dropped
+  bool keyframe_only = keyframeOnly();
+  if (keyframe_only) {
+    settings["vd-lavc-skipframe"] = "nonkey";
+    settings["framedrop"] = "no";
+  }
+  keyframe_only_applied_.store(keyframe_only, std::memory_order_release);
+
+  // Frames beyond the cap are dropped by the VO before scaling and upload,
+  // without reinitializing a filter chain
+  double fps = frameRateCap();
+  if (fps > 0) {
+    settings["video-sync"] = "display-vdrop";
+    settings["override-display-fps"] = QByteArray::number(fps);
+  }
+
+  // Changing vd-lavc options reinitializes the decoder, only touch what
+  // actually changed
+  for (auto it = settings.cbegin(); it != settings.cend(); ++it) {
+    if (it.value().isNull() || quality_applied_.value(it.key()) == it.value()) {
+      continue;
+    }
+    int ret = mpv_set_property_string(mpv_, it.key().constData(),
+                                      it.value().constData());
+    if (ret == MPV_ERROR_SUCCESS) {
+      quality_applied_[it.key()] = it.value();
+    } else {
+      MpvPWarning() << "Error setting " << it.key() << '=' << it.value()
+                    << ": " << mpv_error_string(ret);
+    }
+  }
+}
+
 void MpvPlayer::Private::changeState(PlayState state, bool resume) {
   if (state_ == state) {
     return;
@@ -105,23 +842,125 @@ void MpvPlayer::Private::changeState(PlayState state, bool resume) {
   emit q->playStateChanged(state);
 }
 
+void MpvPlayer::Private::markStartup(StartupPhase phase) {
+  // Events of a file loaded without setUrl() are not part of a startup
+  if (phase > LoadIssued &&
+      startup_[LoadIssued].load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  qint64 expected = 0;
+  startup_[phase].compare_exchange_strong(expected, monotonicNanoseconds(),
+                                          std::memory_order_acq_rel);
+}
+
+void MpvPlayer::Private::beginStartup() {
+  // Construction phases only belong to the first load
+  if (startup_[LoadIssued].load(std::memory_order_acquire) != 0) {
+    for (std::atomic<qint64>& timestamp : startup_) {
+      timestamp.store(0, std::memory_order_release);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_pending_.name = name_;
+    startup_pending_.url = url_;
+  }
+  markStartup(LoadIssued);
+}
+
+bool MpvPlayer::Private::needsRender(const QSize& size) {
+  // Required after each update callback with advanced control
+  uint64_t flags = mpv_render_context_update(mpv_gl_);
+  bool resized = size != rendered_size_;
+  rendered_size_ = size;
+  // Without a new keyframe, the last rendered one is kept
+  return !keyframe_only_applied_.load(std::memory_order_acquire) || resized ||
+         (flags & MPV_RENDER_UPDATE_FRAME);
+}
+
+void MpvPlayer::Private::frameRendered(qint64 render_start) {
+  qint64 now = monotonicNanoseconds();
+  last_frame_time_.store(now, std::memory_order_relaxed);
+  if (render_start != 0) {
+    MpvMetrics::instance().render_time.observe(now - render_start);
+    MpvMetrics::instance().rendered_frames.add();
+  }
+  if (startup_[VideoReconfigured].load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  qint64 expected = 0;
+  if (!startup_[FirstFrame].compare_exchange_strong(
+          expected, monotonicNanoseconds(), std::memory_order_acq_rel)) {
+    return;
+  }
+
+  StartupTimeline timeline;
+  {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    timeline = startup_pending_;
+    for (int phase = 0; phase < StartupPhaseCount; ++phase) {
+      timeline.timestamps[phase] =
+          startup_[phase].load(std::memory_order_acquire);
+    }
+    startup_timeline_ = timeline;
+  }
+  StartupStatistics::instance().record(timeline);
+  MpvMetrics::instance().time_to_first_frame.observe(
+      timeline.timeToFirstFrame());
+  MpvPDebug() << "Time to first frame: "
+              << timeline.timeToFirstFrame() / 1000000.0 << "ms";
+  emit q->startupFinished(timeline);
+}
+
+bool MpvPlayer::Private::onLastEntry() const {
+  std::lock_guard<std::mutex> lock(observed_mutex_);
+  int index = observed_properties_.value("playlist-pos").toInt();
+  int count = observed_properties_.value("playlist").toList().size();
+  return index >= count - 1;
+}
+
+void MpvPlayer::Private::countDroppedFrames(const char* name,
+                                            const QVariant& value) {
+  for (size_t i = 0; i < std::size(drop_counts_); ++i) {
+    if (strcmp(name, MpvMetrics::kDroppedFrameProperties[i]) != 0) {
+      continue;
+    }
+    qint64 count = value.toLongLong();
+    qint64 previous = std::exchange(drop_counts_[i], count);
+    // A first value may include frames dropped before metrics were enabled
+    if (previous >= 0 && count > previous) {
+      MpvMetrics& metrics = MpvMetrics::instance();
+      (render_api_ ? metrics.dropped_frames : metrics.vo_dropped_frames)
+          .add(count - previous);
+    }
+  }
+}
+
 void MpvPlayer::Private::processMpvEvents() {
+  MpvTrace::setThreadName("mpv events " + name_);
   // Process all events, until the event queue is empty.
   while (mpv_event_thread_running_.load(std::memory_order_acquire) && mpv_) {
     mpv_event* event = mpv_wait_event(mpv_, -1);
     if (event->event_id == MPV_EVENT_NONE) {
       continue;
     }
+    qint64 dispatch_start =
+        MpvMetrics::isEnabled() ? monotonicNanoseconds() : 0;
+    MpvTrace::Span span(mpv_event_name(event->event_id));
 
     switch (event->event_id) {
       case MPV_EVENT_START_FILE: {  /// 6: Notification before playback start of
                                     /// a file (before the file is loaded).* See
                                     /// also mpv_event and mpv_event_start_file.
+        markStartup(FileStarted);
+        // Drop counters restart with each file
+        std::fill(std::begin(drop_counts_), std::end(drop_counts_), 0);
         MpvPDebug() << "File start";
       } break;
 
       case MPV_EVENT_PROPERTY_CHANGE: {
         mpv_event_property* prop = (mpv_event_property*)event->data;
+        span.setDetail(prop->name);
         QVariant value;
         switch (prop->format) {
           case MPV_FORMAT_STRING:
@@ -146,6 +985,13 @@ void MpvPlayer::Private::processMpvEvents() {
             break;
         }
         MpvPDebug() << "Property: " << prop->name << ' ' << value;
+        {
+          QString name = QString::fromUtf8(prop->name);
+          qint64 time = monotonicNanoseconds();
+          std::lock_guard<std::mutex> lock(observed_mutex_);
+          observed_properties_.insert(name, value);
+          observed_times_.insert(name, time);
+        }
         if (strcmp(prop->name, "duration") == 0) {
           double time = value.value<double>();
           if (time > 0) {
@@ -155,13 +1001,56 @@ void MpvPlayer::Private::processMpvEvents() {
           bool resume = value.value<bool>();
           changeState(resume ? Play : Pause, resume);
         } else if (strcmp(prop->name, "eof-reached") == 0) {
-          if (value.value<bool>()) {
+          // Reported at the end of every entry, EndReached is for the last
+          if (value.value<bool>() && onLastEntry()) {
             changeState(EndReached);
           }
+        } else if (strcmp(prop->name, "demuxer-cache-state") == 0) {
+          skipToLiveEdge();
+        } else if (strcmp(prop->name, "video-bitrate") == 0 ||
+                   strcmp(prop->name, "audio-bitrate") == 0) {
+          // The time-shift buffer belongs to the GUI thread, resize it there
+          if (time_shift_seconds_ > 0) {
+            QMetaObject::invokeMethod(
+                impl_,
+                [this] {
+                  if (time_shift_seconds_ > 0 && sizeTimeShift(false)) {
+                    applyCachePolicy();
+                  }
+                },
+                Qt::QueuedConnection);
+          }
+        } else if (strcmp(prop->name, "playlist") == 0) {
+          emit q->playlistChanged();
+        } else if (strcmp(prop->name, "playlist-pos") == 0) {
+          emit q->playlistIndexChanged(value.toInt());
+        } else {
+          countDroppedFrames(prop->name, value);
+        }
+      } break;
+
+      case MPV_EVENT_END_FILE: {
+        auto* end_file = static_cast<mpv_event_end_file*>(event->data);
+        EndReason reason = EndReason(end_file->reason);
+        QString error;
+        if (reason == EndError) {
+          error = QString::fromUtf8(mpv_error_string(end_file->error));
+        }
+        {
+          std::lock_guard<std::mutex> lock(observed_mutex_);
+          last_end_error_ = error;
+        }
+        bool last_entry = onLastEntry();
+        last_end_reason_ = reason;
+        MpvPDebug() << "File end " << end_file->reason << ' ' << error;
+        emit q->fileEnded(reason, error);
+        if (reason == EndOfFile && last_entry) {
+          changeState(EndReached);
         }
       } break;
 
       case MPV_EVENT_FILE_LOADED: {
+        markStartup(FileLoaded);
         emit q->videoStarted();
         changeState(Play);
         MpvPDebug() << "File loaded";
@@ -177,6 +1066,15 @@ void MpvPlayer::Private::processMpvEvents() {
          * event can happen sporadically, and you should check yourself whether
          * the video parameters really changed before doing something expensive.
          */
+        markStartup(VideoReconfigured);
+      } break;
+
+      case MPV_EVENT_PLAYBACK_RESTART: {
+        // The first frame is shown as playback starts after the video was
+        // configured
+        if (!render_api_.load(std::memory_order_acquire)) {
+          frameRendered(0);
+        }
       } break;
 
       case MPV_EVENT_AUDIO_RECONFIG: {
@@ -247,9 +1145,17 @@ void MpvPlayer::Private::processMpvEvents() {
         //     continue;
         // }
 
+        trackTransportErrors(prefix, text);
         emit q->newLogMessage(level, prefix, text);
       } break;
 
+      case MPV_EVENT_COMMAND_REPLY: {
+        if (event->error < 0) {
+          MpvPWarning() << "Error executing async command: "
+                        << mpv_error_string(event->error);
+        }
+      } break;
+
       case MPV_EVENT_SHUTDOWN: {
         if (mpv_) {
           mpv_terminate_destroy(std::exchange(mpv_, nullptr));
@@ -260,6 +1166,10 @@ void MpvPlayer::Private::processMpvEvents() {
         // Ignore uninteresting or unknown events.
         break;
     }
+    if (dispatch_start != 0) {
+      MpvMetrics::instance().event_dispatch.observe(monotonicNanoseconds() -
+                                                    dispatch_start);
+    }
   }
   qDebug() << "Finish";
 }
@@ -271,50 +1181,84 @@ void MpvPlayer::playStateChanged(int) {}
 void MpvPlayer::durationChanged(double) {}
 void MpvPlayer::videoStarted() {}
 void MpvPlayer::newLogMessage(int, const QString&, const QString&) {}
+void MpvPlayer::startupFinished(const MpvPlayer::StartupTimeline&) {}
+void MpvPlayer::playlistChanged() {}
+void MpvPlayer::playlistIndexChanged(int) {}
+void MpvPlayer::fileEnded(int, const QString&) {}
+
+qint64 MpvPlayer::StartupTimeline::phaseDuration(StartupPhase phase) const {
+  if (timestamps[phase] == 0) {
+    return 0;
+  }
+  for (int previous = phase - 1; previous >= 0; --previous) {
+    if (timestamps[previous] != 0) {
+      return timestamps[phase] - timestamps[previous];
+    }
+  }
+  return 0;
+}
 
-MpvPlayer::MpvPlayer(QObject* impl, const QString& name)
+qint64 MpvPlayer::StartupTimeline::timeToFirstFrame() const {
+  if (timestamps[FirstFrame] == 0) {
+    return 0;
+  }
+  auto first = std::find_if(timestamps.cbegin(), timestamps.cend(),
+                            [](qint64 timestamp) { return timestamp != 0; });
+  return timestamps[FirstFrame] - *first;
+}
+
+MpvPlayer::StartupTimeline MpvPlayer::startupTimeline() const {
+  std::lock_guard<std::mutex> lock(d->startup_mutex_);
+  return d->startup_timeline_;
+}
+
+qint64 MpvPlayer::lastFrameTime() const {
+  return d->last_frame_time_.load(std::memory_order_relaxed);
+}
+
+MpvPlayer::StartupDurations MpvPlayer::startupPhasePercentile(
+    double percentile) {
+  StartupDurations durations{};
+  for (int phase = 0; phase < StartupPhaseCount; ++phase) {
+    durations[phase] = StartupStatistics::instance().percentile(
+        percentile, [phase](const StartupTimeline& timeline) {
+          return timeline.phaseDuration(StartupPhase(phase));
+        });
+  }
+  return durations;
+}
+
+qint64 MpvPlayer::timeToFirstFramePercentile(double percentile) {
+  return StartupStatistics::instance().percentile(
+      percentile, [](const StartupTimeline& timeline) {
+        return timeline.timeToFirstFrame();
+      });
+}
+
+MpvPlayer::MpvPlayer(QObject* impl, const QString& name,
+                     const MpvPlayerOptions& options)
     : d(new Private(this)) {
+  d->markStartup(Created);
   d->impl_ = impl;
+  d->initial_name_ = name;
   d->name_ = name;
+  qRegisterMetaType<MpvPlayer::StartupTimeline>("MpvPlayer::StartupTimeline");
 
   d->mpv_ = mpv_create();
-  // Enable default bindings, because we're lazy. Normally, a player using
-  // mpv as backend would implement its own key bindings.
-  // CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-default-bindings",
-  // "yes"));
-  CHECK_MPV_ERROR(
-      mpv_set_option_string(d->mpv_, "input-default-bindings", "no"));
-  CHECK_MPV_ERROR(
-      mpv_set_option_string(d->mpv_, "input-builtin-bindings", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-terminal", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-cursor", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-media-keys", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "osc", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "osd-bar", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "network-timeout", "0"));
-
-  // Enable keyboard input on the X11 window. For the messy details, see
-  // --input-vo-keyboard on the manpage.
-  // CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-vo-keyboard",
-  // "yes"));
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "input-vo-keyboard", "no"));
-
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "terminal", "no"));
-  CHECK_MPV_ERROR(mpv_set_option_string(
-      d->mpv_, "msg-level",
-      QLibraryInfo::isDebugBuild() ? "all=debug" : "all=status"));
-
-  // Request hw decoding, just for testing.
-  CHECK_MPV_ERROR(mpv::qt::set_option_variant(d->mpv_, "hwdec", "auto-copy"));
-#ifdef Q_OS_WINDOWS
-  // CHECK_MPV_ERROR(
-  //     mpv::qt::set_option_variant(d->mpv_, "hwdec", "d3d11va-copy"));
-  // CHECK_MPV_ERROR(
-  //     mpv::qt::set_option_variant(d->mpv_, "audio-device", "wasapi"));
-  // CHECK_MPV_ERROR(mpv::qt::set_option_variant(d->mpv_, "vo", "gpu"));
-  // CHECK_MPV_ERROR(mpv::qt::set_option_variant(d->mpv_, "gpu-context",
-  // "d3d11"));
-#endif  // Q_OS_WINDOWS
+  // Apply the whole profile in one batch before mpv_initialize()
+  d->options_ = options;
+  for (const auto& option : options.toMpvOptions()) {
+    int ret = mpv_set_option_string(d->mpv_, option.first.constData(),
+                                    option.second.constData());
+    if (ret != MPV_ERROR_SUCCESS) {
+      MpvWarning() << "Error setting option " << option.first << '='
+                   << option.second << ": " << mpv_error_string(ret);
+    }
+  }
+
+  d->rtsp_transport_ = d->optionRtspTransport();
+  d->active_rtsp_transport_ =
+      d->rtsp_transport_ == RtspAuto ? RtspUdp : d->rtsp_transport_.load();
 
   // Request log messages. They are received as MPV_EVENT_LOG_MESSAGE.
   CHECK_MPV_ERROR(mpv_request_log_messages(
@@ -324,27 +1268,56 @@ MpvPlayer::MpvPlayer(QObject* impl, const QString& name)
   d->mpv_event_thread_ = std::thread([this] { d->processMpvEvents(); });
 
   CHECK_MPV_ERROR(mpv_initialize(d->mpv_));
+  StreamProtocols::instance().addTo(d->mpv_);
+  // Cache options of a profile or options file override the presets of the
+  // source types, read back in mpv's units
+  for (const char* name : kCacheOptions) {
+    if (options.contains(name)) {
+      d->cache_options_.insert(name,
+                               mpv::qt::get_property_variant(d->mpv_, name));
+    }
+  }
+  d->markStartup(Initialized);
 
   CHECK_MPV_ERROR(
       mpv_observe_property(d->mpv_, 0, "duration", MPV_FORMAT_DOUBLE));
   CHECK_MPV_ERROR(mpv_observe_property(d->mpv_, 0, "pause", MPV_FORMAT_FLAG));
   CHECK_MPV_ERROR(
       mpv_observe_property(d->mpv_, 0, "eof-reached", MPV_FORMAT_FLAG));
+  CHECK_MPV_ERROR(
+      mpv_observe_property(d->mpv_, 0, "playlist-pos", MPV_FORMAT_INT64));
+  CHECK_MPV_ERROR(
+      mpv_observe_property(d->mpv_, 0, "playlist", MPV_FORMAT_NODE));
+  CHECK_MPV_ERROR(mpv_observe_property(d->mpv_, 0, "demuxer-cache-state",
+                                       MPV_FORMAT_NODE));
+  observePlayerProperty("time-pos");
+  if (MpvMetrics::isEnabled()) {
+    for (const char* name : MpvMetrics::kDroppedFrameProperties) {
+      observePlayerProperty(name);
+    }
+  }
+
+  MpvResourceGovernor::instance()->addPlayer(this);
 }
 
 MpvPlayer::~MpvPlayer() {
-  stop();
+  MpvResourceGovernor::instance()->removePlayer(this);
+  // The event thread emits signals of this player, it has to be joined here.
+  // Stopping playback and destroying the core is left to the reaper.
   d->mpv_event_thread_running_.store(false, std::memory_order_release);
   mpv_wakeup(d->mpv_);
   if (d->mpv_event_thread_.joinable()) {
     d->mpv_event_thread_.join();
   }
-  // mpv_destroy(std::exchange(d->mpv_, nullptr));
   if (d->mpv_) {
-    mpv_terminate_destroy(std::exchange(d->mpv_, nullptr));
+    Reaper::instance().destroy(std::exchange(d->mpv_, nullptr));
   }
 }
 
+bool MpvPlayer::waitForTeardown(int msec) {
+  return Reaper::instance().wait(msec);
+}
+
 void MpvPlayer::disableAudio() {
   setPlayerProperty("ao", "no");
   setPlayerProperty("aid", "no");
@@ -366,6 +1339,287 @@ void MpvPlayer::enableHighPerformanceMode() {
   setPlayerProperty("zimg-fast", "yes");
 }
 
+MpvPlayer::QualityLevel MpvPlayer::qualityLevel() const {
+  return d->quality_level_;
+}
+
+void MpvPlayer::setQualityLevel(QualityLevel level) {
+  if (level < FullQuality || level >= QualityLevelCount) {
+    return;
+  }
+  if (level != d->quality_level_ || d->quality_baseline_.isEmpty()) {
+    d->quality_level_ = level;
+    d->applyQuality();
+    MpvDebug() << "Quality level: " << level;
+  }
+}
+
+int MpvPlayer::qualityDegradation() const { return d->quality_degradation_; }
+
+void MpvPlayer::setQualityDegradation(int steps) {
+  steps = std::clamp(steps, 0, maxQualityDegradation());
+  if (steps != d->quality_degradation_) {
+    d->quality_degradation_ = steps;
+    d->applyQuality();
+    MpvDebug() << "Quality degradation: " << steps;
+  }
+}
+
+MpvPlayer::QualityLevel MpvPlayer::effectiveQualityLevel() const {
+  return d->effectiveQualityLevel();
+}
+
+int MpvPlayer::maxQualityDegradation() const {
+  // One more step than levels, to keyframe-only decoding
+  return QualityLevelCount - d->quality_level_;
+}
+
+double MpvPlayer::maxFrameRate() const { return d->max_frame_rate_; }
+
+void MpvPlayer::setMaxFrameRate(double fps) {
+  fps = std::max(fps, 0.0);
+  if (fps != d->max_frame_rate_) {
+    d->max_frame_rate_ = fps;
+    d->applyQuality();
+    MpvDebug() << "Max frame rate: " << fps;
+  }
+}
+
+QMap<int, double> MpvPlayer::heightFrameRates() const {
+  return d->height_frame_rates_;
+}
+
+void MpvPlayer::setHeightFrameRates(const QMap<int, double>& rates) {
+  if (rates != d->height_frame_rates_) {
+    d->height_frame_rates_ = rates;
+    d->applyQuality();
+  }
+}
+
+double MpvPlayer::frameRateCap() const { return d->frameRateCap(); }
+
+bool MpvPlayer::isKeyframeOnly() const { return d->keyframeOnly(); }
+
+void MpvPlayer::setKeyframeOnly(bool enabled) {
+  if (enabled != d->keyframe_only_) {
+    d->keyframe_only_ = enabled;
+    d->applyQuality();
+    MpvDebug() << "Keyframe only: " << enabled;
+  }
+}
+
+MpvPlayerOptions MpvPlayer::options() const { return d->options_; }
+
+int MpvPlayer::decoderThreads() const { return d->decoder_threads_; }
+
+void MpvPlayer::setDecoderThreads(int threads) {
+  threads = std::max(threads, 0);
+  if (threads == d->decoder_threads_ || !d->mpv_) {
+    return;
+  }
+  d->decoder_threads_ = threads;
+  // Not tracked by reset(), the share outlives the source
+  CHECK_MPV_ERROR(mpv::qt::set_property_variant(d->mpv_, "vd-lavc-threads",
+                                                threads));
+  MpvDebug() << "Decoder threads: " << threads;
+}
+
+MpvPlayer::SourceType MpvPlayer::sourceType(const QUrl& url) {
+  static const QStringList live_schemes = {"rtsp", "rtsps", "rtmp", "rtmps",
+                                           "rtp",  "srt",   "udp",  "tcp"};
+  QString scheme = url.scheme().toLower();
+  if (url.isLocalFile() || scheme == "mmap") {
+    return LocalSource;
+  } else if (live_schemes.contains(scheme)) {
+    return LiveSource;
+  } else {
+    return NetworkSource;
+  }
+}
+
+MpvPlayer::CachePolicy MpvPlayer::CachePolicy::preset(SourceType source) {
+  constexpr qint64 MiB = 1024 * 1024;
+  CachePolicy policy;
+  policy.source = source;
+  switch (source) {
+    case LiveSource:
+      // Only enough to ride out jitter, the past is never seeked to
+      policy.max_bytes = 8 * MiB;
+      policy.max_back_bytes = 0;
+      policy.readahead_seconds = 1;
+      break;
+    case NetworkSource:
+      policy.max_bytes = 64 * MiB;
+      policy.max_back_bytes = 16 * MiB;
+      policy.readahead_seconds = 20;
+      break;
+    case LocalSource:
+      // The disk is the cache
+      policy.cache = false;
+      policy.max_bytes = 16 * MiB;
+      policy.max_back_bytes = 4 * MiB;
+      policy.readahead_seconds = 2;
+      break;
+    case AutoSource:
+    default:
+      break;
+  }
+  return policy;
+}
+
+MpvPlayer::CachePolicy MpvPlayer::cachePolicy() const {
+  return d->cache_policy_;
+}
+
+void MpvPlayer::setCachePolicy(const CachePolicy& policy) {
+  d->cache_policy_ = policy;
+  d->applyCachePolicy();
+}
+
+qint64 MpvPlayer::cacheLimit() const { return d->cache_limit_; }
+
+void MpvPlayer::setCacheLimit(qint64 bytes) {
+  bytes = std::max<qint64>(bytes, 0);
+  if (bytes != d->cache_limit_) {
+    d->cache_limit_ = bytes;
+    d->applyCachePolicy();
+  }
+}
+
+MpvPlayer::CachePolicy MpvPlayer::effectiveCachePolicy() const {
+  return d->effectiveCachePolicy();
+}
+
+QVariantMap MpvPlayer::cacheState() const {
+  return observedPlayerProperty("demuxer-cache-state").toMap();
+}
+
+MpvPlayer::RtspTransport MpvPlayer::rtspTransport() const {
+  return d->rtsp_transport_;
+}
+
+void MpvPlayer::setRtspTransport(RtspTransport transport) {
+  d->rtsp_transport_ = transport;
+  d->active_rtsp_transport_ = transport == RtspAuto ? RtspUdp : transport;
+  d->applyRtspTransport();
+}
+
+MpvPlayer::RtspTransport MpvPlayer::activeRtspTransport() const {
+  return d->active_rtsp_transport_;
+}
+
+int MpvPlayer::rtspFallbackThreshold() const {
+  return d->rtsp_fallback_threshold_;
+}
+
+void MpvPlayer::setRtspFallbackThreshold(int errors) {
+  d->rtsp_fallback_threshold_ = std::max(errors, 1);
+}
+
+qint64 MpvPlayer::packetLossCount() const { return d->packets_lost_; }
+
+qint64 MpvPlayer::decodeErrorCount() const { return d->decode_errors_; }
+
+int MpvPlayer::transportFallbackCount() const {
+  return d->transport_fallbacks_;
+}
+
+bool MpvPlayer::isLowLatency() const { return d->low_latency_; }
+
+void MpvPlayer::setLowLatency(bool enabled) {
+  // Runtime equivalent of profile=low-latency, without its video-sync and
+  // decoder threads which are managed elsewhere
+  static const QVariantMap properties = {
+      {"untimed", "yes"},
+      {"audio-buffer", "0"},
+      {"cache-pause", "no"},
+      {"interpolation", "no"},
+      {"video-latency-hacks", "yes"},
+      {"demuxer-lavf-probe-info", "nostreams"},
+      {"demuxer-lavf-analyzeduration", "0.1"},
+      {"stream-buffer-size", "4k"},
+  };
+  if (enabled == d->low_latency_ || !d->mpv_) {
+    return;
+  }
+  d->low_latency_ = enabled;
+  if (enabled) {
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+      d->low_latency_baseline_.insert(
+          it.key(), mpv::qt::get_property_variant(d->mpv_, it.key()));
+      CHECK_MPV_ERROR(
+          mpv::qt::set_property_variant(d->mpv_, it.key(), it.value()));
+    }
+    // The profile adds fflags=+nobuffer to the lavf options, which keeps
+    // libavformat from buffering packets while probing
+    QVariantMap options =
+        mpv::qt::get_property_variant(d->mpv_, "demuxer-lavf-o").toMap();
+    d->low_latency_baseline_.insert("demuxer-lavf-o", options);
+    QString flags = options.value("fflags").toString();
+    if (!flags.contains("+nobuffer")) {
+      options.insert("fflags", flags + "+nobuffer");
+    }
+    CHECK_MPV_ERROR(
+        mpv::qt::set_property_variant(d->mpv_, "demuxer-lavf-o", options));
+  } else {
+    QVariantMap baseline = std::exchange(d->low_latency_baseline_, {});
+    for (auto it = baseline.cbegin(); it != baseline.cend(); ++it) {
+      if (it.value().isValid()) {
+        CHECK_MPV_ERROR(
+            mpv::qt::set_property_variant(d->mpv_, it.key(), it.value()));
+      }
+    }
+  }
+  d->applyCachePolicy();
+}
+
+double MpvPlayer::maxLiveLatency() const { return d->max_live_latency_; }
+
+void MpvPlayer::setMaxLiveLatency(double seconds) {
+  d->max_live_latency_ = std::max(seconds, 0.0);
+}
+
+double MpvPlayer::liveLatency() const {
+  QVariant cache_end = cacheState().value("cache-end");
+  QVariant position = observedPlayerProperty("time-pos");
+  if (!cache_end.isValid() || !position.isValid()) {
+    return 0;
+  }
+  return std::max(cache_end.toDouble() - position.toDouble(), 0.0);
+}
+
+double MpvPlayer::timeShiftSeconds() const { return d->time_shift_seconds_; }
+
+void MpvPlayer::setTimeShift(double seconds, bool on_disk) {
+  // The buffer is resized as the bitrates arrive
+  observePlayerProperty("video-bitrate");
+  observePlayerProperty("audio-bitrate");
+  observePlayerProperty("time-pos");
+
+  d->time_shift_seconds_ = std::max(seconds, 0.0);
+  d->time_shift_on_disk_ = on_disk;
+  d->sizeTimeShift(true);
+  d->applyCachePolicy();
+}
+
+double MpvPlayer::bufferedStart() const { return d->bufferedRange().first; }
+
+double MpvPlayer::bufferedEnd() const { return d->bufferedRange().second; }
+
+void MpvPlayer::replay(double seconds) {
+  QPair<double, double> range = d->bufferedRange();
+  double position = observedPlayerProperty("time-pos").toDouble();
+  playerCommandAsync("seek", std::max(position - seconds, range.first),
+                     "absolute");
+}
+
+void MpvPlayer::goLive() {
+  QPair<double, double> range = d->bufferedRange();
+  if (range.second > 0) {
+    playerCommandAsync("seek", range.second, "absolute");
+  }
+}
+
 QString MpvPlayer::name() const { return d->name_; }
 
 void MpvPlayer::setName(const QString& name) {
@@ -379,7 +1633,6 @@ void MpvPlayer::setUrl(const QUrl& url) {
   if (url.isEmpty()) {
     return;
   }
-  stop();
 
   if (d->name_.isEmpty()) {
     QString name = url.toString();
@@ -388,19 +1641,117 @@ void MpvPlayer::setUrl(const QUrl& url) {
     setName(name);
   }
 
+  // A new source starts over UDP again, a reconnect stays on TCP
+  if (url != d->url_ && d->rtsp_transport_ == RtspAuto) {
+    d->active_rtsp_transport_ = RtspUdp;
+  }
   d->url_ = url;
-  CHECK_MPV_ERROR(mpv_set_option_string(d->mpv_, "rtsp-transport", "udp"));
 
-  if (d->url_.isLocalFile()) {
-    playerCommand("loadfile", d->url_.toLocalFile());
+  d->applyRtspTransport();
+  d->applyCachePolicy();
+  d->beginStartup();
+  // Replacing the current file stops it in the core, without a blocking stop
+  // command before the load
+  d->changeState(Stop);
+  playerCommandAsync("loadfile", Private::source(d->url_), "replace");
+  emit urlChanged(d->url_);
+}
+
+void MpvPlayer::appendUrl(const QUrl& url) {
+  if (!url.isEmpty()) {
+    playerCommandAsync("loadfile", Private::source(url), "append-play");
+  }
+}
+
+void MpvPlayer::insertUrl(int index, const QUrl& url) {
+  if (url.isEmpty()) {
+    return;
+  }
+  int count = observedPlayerProperty("playlist").toList().size();
+  if (index < 0 || index >= count) {
+    appendUrl(url);
+    return;
+  }
+  // insert-at came with client API 2.3 (mpv 0.38), older cores append and
+  // move, in order since both are queued
+  if (mpv_client_api_version() >= MPV_MAKE_VERSION(2, 3)) {
+    playerCommandAsync("loadfile", Private::source(url), "insert-at-play",
+                       index);
   } else {
-    playerCommand("loadfile", d->url_.toString());
+    appendUrl(url);
+    playerCommandAsync("playlist-move", count, index);
   }
-  emit urlChanged(d->url_);
+}
+
+void MpvPlayer::removeUrl(int index) {
+  playerCommandAsync("playlist-remove", index);
+}
+
+void MpvPlayer::moveUrl(int from, int to) {
+  // mpv moves the entry in front of the target entry
+  if (from != to) {
+    playerCommandAsync("playlist-move", from, to > from ? to + 1 : to);
+  }
+}
+
+void MpvPlayer::clearPlaylist() { playerCommandAsync("playlist-clear"); }
+
+QList<QUrl> MpvPlayer::playlist() const {
+  QList<QUrl> urls;
+  for (const QVariant& entry : observedPlayerProperty("playlist").toList()) {
+    QString filename = entry.toMap().value("filename").toString();
+    QUrl url(filename);
+    // Local paths, including Windows drive letters
+    urls << (url.scheme().size() > 1 ? url : QUrl::fromLocalFile(filename));
+  }
+  return urls;
+}
+
+int MpvPlayer::playlistIndex() const {
+  QVariant index = observedPlayerProperty("playlist-pos");
+  return index.isValid() ? index.toInt() : -1;
+}
+
+void MpvPlayer::setPlaylistIndex(int index) {
+  playerCommandAsync("playlist-play-index", index);
+}
+
+bool MpvPlayer::registerStreamProtocol(const QString& scheme,
+                                       const StreamFactory& factory) {
+  if (scheme.isEmpty() || !factory) {
+    return false;
+  }
+  // The players are listed and destroyed on the GUI thread
+  QCoreApplication* app = QCoreApplication::instance();
+  if (app && QThread::currentThread() != app->thread()) {
+    qCWarning(MPV) << "registerStreamProtocol() outside the GUI thread";
+    return false;
+  }
+  // A protocol can only be added once to a handle, players use the latest
+  // factory through the entry
+  if (StreamProtocols::instance().set(scheme, factory)) {
+    for (MpvPlayer* player : MpvResourceGovernor::instance()->players()) {
+      if (player->d->mpv_) {
+        StreamProtocols::instance().addTo(player->d->mpv_, scheme);
+      }
+    }
+  }
+  return true;
+}
+
+MpvPlayer::EndReason MpvPlayer::lastEndReason() const {
+  return d->last_end_reason_;
+}
+
+QString MpvPlayer::lastEndError() const {
+  std::lock_guard<std::mutex> lock(d->observed_mutex_);
+  return d->last_end_error_;
 }
 
 QUrl MpvPlayer::url() const { return d->url_; }
 
+MpvPlayer::PlayState MpvPlayer::playState() const { return d->state_; }
+
 void MpvPlayer::play(const QUrl& url) {
   if (!url.isEmpty()) {
     setUrl(url);
@@ -425,7 +1776,63 @@ void MpvPlayer::setPaused(bool paused) {
 
 void MpvPlayer::resume() { setPlayerProperty("pause", false); }
 
-void MpvPlayer::stop() { playerCommand("stop"); }
+void MpvPlayer::stop() { playerCommandAsync("stop"); }
+
+void MpvPlayer::reset() {
+  stop();
+  uncropVideo();
+
+  // Modes of the previous source
+  setLowLatency(false);
+  d->max_live_latency_ = 0.5;
+  d->cache_policy_ = CachePolicy();
+  d->time_shift_seconds_ = 0;
+  d->time_shift_on_disk_ = false;
+  d->time_shift_bytes_ = 0;
+  d->time_shift_bitrate_ = 0;
+  d->applyCachePolicy();
+  setRtspTransport(d->optionRtspTransport());
+  d->rtsp_fallback_threshold_ = 10;
+
+  d->quality_level_ = FullQuality;
+  d->quality_degradation_ = 0;
+  d->keyframe_only_ = false;
+  d->max_frame_rate_ = 0;
+  d->height_frame_rates_.clear();
+  if (!d->quality_baseline_.isEmpty()) {
+    d->applyQuality();
+  }
+
+  if (auto* quick = qobject_cast<MpvPlayerQuickObject*>(d->impl_)) {
+    quick->stats()->setInterval(0);
+  }
+
+  // Properties which are not options keep their value
+  const QSet<QString> names = std::exchange(d->written_properties_, {});
+  for (const QString& name : names) {
+    if (!d->mpv_) {
+      break;
+    }
+    QString default_value = "option-info/" + name + "/default-value";
+    QVariant value =
+        d->options_.contains(name)
+            ? d->options_.value(name)
+            : mpv::qt::get_property_variant(d->mpv_, default_value);
+    if (value.isValid()) {
+      CHECK_MPV_ERROR(mpv::qt::set_property_variant(d->mpv_, name, value));
+    }
+  }
+  // Quality properties may have been restored above, the next level change
+  // captures them again
+  d->quality_baseline_.clear();
+  d->quality_applied_.clear();
+
+  setName(d->initial_name_);
+  if (!d->url_.isEmpty()) {
+    d->url_ = QUrl();
+    emit urlChanged(d->url_);
+  }
+}
 
 QSize MpvPlayer::videoSize() const {
   return QSize(getPlayerProperty<int>("width"),
@@ -437,6 +1844,8 @@ QSize MpvPlayer::displaySize() const {
                getPlayerProperty<int>("dheight"));
 }
 
+QSize MpvPlayer::surfaceSize() const { return d->surface_size_; }
+
 void MpvPlayer::setCropVideo(const QRect& rect) {
   // https://ffmpeg.org/ffmpeg-filters.html#crop
   uncropVideo();
@@ -466,6 +1875,7 @@ void MpvPlayer::setCropVideo(const QRectF& rect_ratio) {
 void MpvPlayer::uncropVideo() { playerCommand("vf", "remove", "@crop"); }
 
 QVariant MpvPlayer::command(const QVariant& args) {
+  MpvTrace::Span span("command", args);
   if (d->mpv_) {
     QVariant ret = mpv::qt::command_variant(d->mpv_, args);
     MpvDebug() << "command " << args << ": " << ret;
@@ -478,8 +1888,23 @@ QVariant MpvPlayer::command(const QVariant& args) {
   }
 }
 
+void MpvPlayer::commandAsync(const QVariant& args) {
+  MpvTrace::Span span("commandAsync", args);
+  if (d->mpv_) {
+    // The arguments are copied by mpv, errors are logged by the event thread
+    mpv::qt::node_builder node(args);
+    CHECK_MPV_ERROR(mpv_command_node_async(d->mpv_, 0, node.node()));
+    MpvDebug() << "commandAsync " << args;
+    if (args.toList().contains("stop")) {
+      d->changeState(Stop);
+    }
+  }
+}
+
 bool MpvPlayer::setPlayerProperty(const QString& name, const QVariant& value) {
+  MpvTrace::Span span("setProperty", name);
   if (d->mpv_) {
+    d->written_properties_.insert(name);
     int ret = 0;
     CHECK_MPV_ERROR_RET(ret,
                         mpv::qt::set_property_variant(d->mpv_, name, value));
@@ -491,6 +1916,7 @@ bool MpvPlayer::setPlayerProperty(const QString& name, const QVariant& value) {
 }
 
 QVariant MpvPlayer::getPlayerProperty_(const QString& name) const {
+  MpvTrace::Span span("getProperty", name);
   if (d->mpv_) {
     QVariant value = mpv::qt::get_property_variant(d->mpv_, name);
     MpvDebug() << "getProperty " << name << ": " << value;
@@ -500,11 +1926,54 @@ QVariant MpvPlayer::getPlayerProperty_(const QString& name) const {
   }
 }
 
+void MpvPlayer::observePlayerProperty(const QString& name) {
+  if (!d->mpv_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(d->observed_mutex_);
+    if (d->observed_names_.contains(name)) {
+      return;
+    }
+    d->observed_names_.insert(name);
+  }
+  CHECK_MPV_ERROR(mpv_observe_property(d->mpv_, 0, name.toUtf8().constData(),
+                                       MPV_FORMAT_NODE));
+}
+
+QVariant MpvPlayer::observedPlayerProperty(const QString& name) const {
+  std::lock_guard<std::mutex> lock(d->observed_mutex_);
+  return d->observed_properties_.value(name);
+}
+
+QVariant MpvPlayer::observedPlayerProperty(const QString& name,
+                                           qint64* age) const {
+  std::lock_guard<std::mutex> lock(d->observed_mutex_);
+  auto time = d->observed_times_.constFind(name);
+  *age = time == d->observed_times_.cend() ? -1
+                                           : monotonicNanoseconds() - *time;
+  return d->observed_properties_.value(name);
+}
+
+QVariantMap MpvPlayer::observedPlayerProperties(
+    const QStringList& names) const {
+  QVariantMap values;
+  std::lock_guard<std::mutex> lock(d->observed_mutex_);
+  for (const QString& name : names) {
+    values.insert(name, d->observed_properties_.value(name));
+  }
+  return values;
+}
+
 void MpvPlayer::processQEvent(QEvent* event) {
   switch (event->type()) {
     case QEvent::LanguageChange:
       break;
 
+    case QEvent::Resize:
+      d->setSurfaceSize(static_cast<QResizeEvent*>(event)->size());
+      break;
+
     default:
       break;
   }
@@ -512,7 +1981,14 @@ void MpvPlayer::processQEvent(QEvent* event) {
 
 MpvPlayerWidget::MpvPlayerWidget(const QString& name, QWidget* parent,
                                  Qt::WindowFlags f)
-    : QWidget(parent, f), MpvPlayer(this, name), d(MpvPlayer::d.get()) {
+    : MpvPlayerWidget(MpvPlayerOptions::defaults(), name, parent, f) {}
+
+MpvPlayerWidget::MpvPlayerWidget(const MpvPlayerOptions& options,
+                                 const QString& name, QWidget* parent,
+                                 Qt::WindowFlags f)
+    : QWidget(parent, f),
+      MpvPlayer(this, name, options),
+      d(MpvPlayer::d.get()) {
   CHECK_MPV_ERROR(mpv::qt::set_option_variant(d->mpv_, "vo", "gpu-next"));
 
   setAttribute(Qt::WA_DontCreateNativeAncestors, true);
@@ -526,9 +2002,99 @@ bool MpvPlayerWidget::event(QEvent* event) {
   return QWidget::event(event);
 }
 
+MpvPlayerObject::MpvPlayerObject(const QString& name, QObject* parent)
+    : MpvPlayerObject(MpvPlayerOptions::defaults(), name, parent) {}
+
+MpvPlayerObject::MpvPlayerObject(const MpvPlayerOptions& options,
+                                 const QString& name, QObject* parent)
+    : QObject(parent), MpvPlayer(this, name, options), d(MpvPlayer::d.get()) {
+  if (!options.contains("vo")) {
+    CHECK_MPV_ERROR(mpv::qt::set_option_variant(d->mpv_, "vo", "null"));
+  }
+  if (options.value("vo").toString() != "libmpv" || !d->mpv_) {
+    return;
+  }
+  d->render_api_ = true;
+
+  int advanced_control = 1;
+  mpv_render_param params[]{
+      {MPV_RENDER_PARAM_API_TYPE, const_cast<char*>(MPV_RENDER_API_TYPE_SW)},
+      {MPV_RENDER_PARAM_ADVANCED_CONTROL, &advanced_control},
+      {MPV_RENDER_PARAM_INVALID, nullptr}};
+  if (mpv_render_context_create(&d->mpv_gl_, d->mpv_, params) < 0) {
+    MpvWarning() << "Failed to initialize the software renderer";
+    return;
+  }
+  d->setSurfaceSize(render_size_);
+  mpv_render_context_set_update_callback(
+      d->mpv_gl_,
+      [](void* ctx) {
+        MpvTrace::Span span("update");
+        auto* player = static_cast<MpvPlayerObject*>(ctx);
+        QMetaObject::invokeMethod(
+            player, [player] { player->renderFrame(); },
+            Qt::QueuedConnection);
+      },
+      this);
+}
+
+MpvPlayerObject::~MpvPlayerObject() {
+  if (d->mpv_gl_) {
+    mpv_render_context_free(std::exchange(d->mpv_gl_, nullptr));
+  }
+}
+
+QSize MpvPlayerObject::renderSize() const { return render_size_; }
+
+void MpvPlayerObject::setRenderSize(const QSize& size) {
+  render_size_ = size;
+  if (d->mpv_gl_) {
+    d->setSurfaceSize(size);
+  }
+}
+
+QImage MpvPlayerObject::lastFrame() const { return frame_; }
+
+void MpvPlayerObject::renderFrame() {
+  MpvTrace::Span span("render", d->name_);
+  if (!d->mpv_gl_ || render_size_.isEmpty() || !d->needsRender(render_size_)) {
+    return;
+  }
+  if (frame_.size() != render_size_) {
+    frame_ = QImage(render_size_, QImage::Format_RGB32);
+  }
+
+  int size[] = {render_size_.width(), render_size_.height()};
+  // Format_RGB32 is 0xffRRGGBB in native byte order
+  const char* format =
+      QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "bgr0" : "0rgb";
+  size_t stride = frame_.bytesPerLine();
+  mpv_render_param params[] = {
+      {MPV_RENDER_PARAM_SW_SIZE, size},
+      {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char*>(format)},
+      {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+      {MPV_RENDER_PARAM_SW_POINTER, frame_.bits()},
+      {MPV_RENDER_PARAM_INVALID, nullptr}};
+  qint64 render_start = MpvMetrics::isEnabled() ? monotonicNanoseconds() : 0;
+  mpv_render_context_render(d->mpv_gl_, params);
+  d->frameRendered(render_start);
+  emit frameReady(frame_);
+}
+
 MpvPlayerOpenGLWidget::MpvPlayerOpenGLWidget(const QString& name,
                                              QWidget* parent, Qt::WindowFlags f)
-    : QOpenGLWidget(parent, f), MpvPlayer(this, name), d(MpvPlayer::d.get()) {}
+    : MpvPlayerOpenGLWidget(MpvPlayerOptions::defaults(), name, parent, f) {}
+
+MpvPlayerOpenGLWidget::MpvPlayerOpenGLWidget(const MpvPlayerOptions& options,
+                                             const QString& name,
+                                             QWidget* parent, Qt::WindowFlags f)
+    : QOpenGLWidget(parent, f),
+      MpvPlayer(this, name, options),
+      d(MpvPlayer::d.get()) {
+  d->render_api_ = true;
+  // Keep the last frame when paintGL() has nothing new to render
+  setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+}
 
 MpvPlayerOpenGLWidget::~MpvPlayerOpenGLWidget() {
   makeCurrent();
@@ -566,6 +2132,10 @@ void MpvPlayerOpenGLWidget::initializeGL() {
 }
 
 void MpvPlayerOpenGLWidget::paintGL() {
+  MpvTrace::Span span("render", d->name_);
+  if (!d->needsRender(size())) {
+    return;
+  }
   mpv_opengl_fbo mpfbo{int(defaultFramebufferObject()), width(), height(), 0};
   int flip_y = 1;
 
@@ -574,7 +2144,9 @@ void MpvPlayerOpenGLWidget::paintGL() {
                                {MPV_RENDER_PARAM_INVALID, nullptr}};
   // See render_gl.h on what OpenGL environment mpv expects, and
   // other API details.
+  qint64 render_start = MpvMetrics::isEnabled() ? monotonicNanoseconds() : 0;
   mpv_render_context_render(d->mpv_gl_, params);
+  d->frameRendered(render_start);
 }
 
 void* MpvPlayerOpenGLWidget::get_proc_address(void* ctx, const char* name) {
@@ -588,6 +2160,7 @@ void* MpvPlayerOpenGLWidget::get_proc_address(void* ctx, const char* name) {
 }
 
 void MpvPlayerOpenGLWidget::on_update(void* cb_ctx) {
+  MpvTrace::Span span("update");
   MpvPlayerOpenGLWidget* canvas = static_cast<MpvPlayerOpenGLWidget*>(cb_ctx);
   QMetaObject::invokeMethod(canvas, [canvas] { canvas->maybeUpdate(); });
 }
@@ -646,6 +2219,7 @@ class MpvPlayerQuickObject::MpvQuickRenderer
       mpv_render_context_set_update_callback(
           d->mpv_gl_,
           [](void* ctx) {
+            MpvTrace::Span span("update");
             QMetaObject::invokeMethod(static_cast<MpvPlayerQuickObject*>(ctx),
                                       &MpvPlayerQuickObject::update,
                                       Qt::QueuedConnection);
@@ -657,9 +2231,13 @@ class MpvPlayerQuickObject::MpvQuickRenderer
   }
 
   void render() override {
+    MpvTrace::Span span("render", d->name_);
+    QOpenGLFramebufferObject* fbo = framebufferObject();
+    if (!d->needsRender(fbo->size())) {
+      return;
+    }
     obj->window()->resetOpenGLState();
 
-    QOpenGLFramebufferObject* fbo = framebufferObject();
     mpv_opengl_fbo mpfbo{int(fbo->handle()), fbo->width(), fbo->height(), 0};
     int flip_y = 0;
 
@@ -674,7 +2252,10 @@ class MpvPlayerQuickObject::MpvQuickRenderer
         {MPV_RENDER_PARAM_INVALID, nullptr}};
     // See render_gl.h on what OpenGL environment mpv expects, and
     // other API details.
+    qint64 render_start =
+        MpvMetrics::isEnabled() ? monotonicNanoseconds() : 0;
     mpv_render_context_render(d->mpv_gl_, params);
+    d->frameRendered(render_start);
 
     obj->window()->resetOpenGLState();
   }
@@ -686,9 +2267,22 @@ class MpvPlayerQuickObject::MpvQuickRenderer
 
 MpvPlayerQuickObject::MpvPlayerQuickObject(const QString& name,
                                            QQuickItem* parent)
+    : MpvPlayerQuickObject(MpvPlayerOptions::defaults(), name, parent) {}
+
+MpvPlayerQuickObject::MpvPlayerQuickObject(const MpvPlayerOptions& options,
+                                           const QString& name,
+                                           QQuickItem* parent)
     : QQuickFramebufferObject(parent),
-      MpvPlayer(this, name),
-      d(MpvPlayer::d.get()) {}
+      MpvPlayer(this, name, options),
+      d(MpvPlayer::d.get()),
+      stats_(new MpvPlayerStats(this, this)) {
+  d->render_api_ = true;
+  auto resized = [this] {
+    d->setSurfaceSize(QSizeF(width(), height()).toSize());
+  };
+  connect(this, &QQuickItem::widthChanged, this, resized);
+  connect(this, &QQuickItem::heightChanged, this, resized);
+}
 
 MpvPlayerQuickObject::~MpvPlayerQuickObject() {
   if (d->mpv_gl_) {
@@ -696,6 +2290,8 @@ MpvPlayerQuickObject::~MpvPlayerQuickObject() {
   }
 }
 
+MpvPlayerStats* MpvPlayerQuickObject::stats() const { return stats_; }
+
 MpvPlayerQuickObject::Renderer* MpvPlayerQuickObject::createRenderer() const {
   window()->setPersistentOpenGLContext(true);
   window()->setPersistentSceneGraph(true);
@@ -0,0 +1,280 @@
+#include "MpvPlayerOptions.hpp"
+
+namespace {
+const QString kBaseKey = QStringLiteral("base");
+const QString kDefaultProfile = QStringLiteral("default");
+constexpr int kMaxBaseDepth = 8;
+
+// Options every embedded player needs, all built-in profiles extend them
+QVariantMap defaultOptions() {
+  QVariantMap options;
+  // Enable default bindings, because we're lazy. Normally, a player using
+  // mpv as backend would implement its own key bindings.
+  // options["input-default-bindings"] = "yes";
+  options["input-default-bindings"] = "no";
+  options["input-builtin-bindings"] = "no";
+  options["input-terminal"] = "no";
+  options["input-cursor"] = "no";
+  options["input-media-keys"] = "no";
+  options["osc"] = "no";
+  options["osd-bar"] = "no";
+  options["network-timeout"] = "0";
+
+  // Enable keyboard input on the X11 window. For the messy details, see
+  // --input-vo-keyboard on the manpage.
+  // options["input-vo-keyboard"] = "yes";
+  options["input-vo-keyboard"] = "no";
+
+  options["terminal"] = "no";
+  options["msg-level"] =
+      QLibraryInfo::isDebugBuild() ? "all=debug" : "all=status";
+
+  // Request hw decoding, just for testing.
+  options["hwdec"] = "auto-copy";
+#ifdef Q_OS_WINDOWS
+  // options["hwdec"] = "d3d11va-copy";
+  // options["audio-device"] = "wasapi";
+  // options["vo"] = "gpu";
+  // options["gpu-context"] = "d3d11";
+#endif  // Q_OS_WINDOWS
+
+  // Open the next playlist entry while the current one plays, and join the
+  // audio of consecutive entries without a gap
+  options["prefetch-playlist"] = "yes";
+  options["gapless-audio"] = "yes";
+  return options;
+}
+
+const QMap<QString, QVariantMap>& builtinProfileOptions() {
+  static const QMap<QString, QVariantMap> profiles = [] {
+    QMap<QString, QVariantMap> profiles;
+    profiles[kDefaultProfile] = {};
+
+    // Show live sources as soon as possible, at the cost of smoothness
+    profiles["low-latency-live"] = {
+        {"profile", "low-latency"},
+        {"untimed", "yes"},
+        {"cache", "no"},
+        {"demuxer-max-bytes", "4MiB"},
+        {"demuxer-max-back-bytes", "0"},
+        {"demuxer-lavf-analyzeduration", "0.5"},
+        {"framedrop", "vo"},
+    };
+
+    // Recorded files, best scaling and a large readahead
+    profiles["vod-quality"] = {
+        {"cache", "yes"},
+        {"demuxer-readahead-secs", "20"},
+        {"scale", "spline36"},
+        {"cscale", "spline36"},
+        {"dscale", "mitchell"},
+        {"deband", "yes"},
+        {"rtsp-transport", "tcp"},
+    };
+
+    // One of many small tiles of a video wall
+    profiles["wall-tile"] = {
+        {"framedrop", "vo"},
+        {"scale", "bilinear"},
+        {"dscale", "bilinear"},
+        {"cscale", "bilinear"},
+        {"sws-fast", "yes"},
+        {"zimg-fast", "yes"},
+        {"vd-lavc-fast", "yes"},
+        {"demuxer-max-bytes", "16MiB"},
+        {"demuxer-max-back-bytes", "0"},
+        {"mute", "yes"},
+    };
+    return profiles;
+  }();
+  return profiles;
+}
+
+QByteArray toOptionString(const QVariant& value) {
+  switch (value.userType()) {
+    case QMetaType::Bool:
+      return value.toBool() ? "yes" : "no";
+    case QMetaType::QStringList:
+    case QMetaType::QVariantList:
+      // QSettings splits INI values at commas
+      return value.toStringList().join(',').toUtf8();
+    default:
+      return value.toString().toUtf8();
+  }
+}
+
+// Profiles of a file by name, top-level options are stored under ""
+QMap<QString, QVariantMap> readProfiles(const QString& path, bool* ok) {
+  QMap<QString, QVariantMap> profiles;
+  *ok = false;
+  QFileInfo info(path);
+  if (info.suffix().compare("json", Qt::CaseInsensitive) == 0) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return profiles;
+    }
+    QJsonParseError error;
+    QJsonDocument json = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !json.isObject()) {
+      return profiles;
+    }
+    QJsonObject root = json.object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+      if (it.value().isObject()) {
+        profiles[it.key()] = it.value().toObject().toVariantMap();
+      } else {
+        profiles[""][it.key()] = it.value().toVariant();
+      }
+    }
+  } else {
+    // QSettings reads a missing file as an empty one without an error
+    if (!info.isFile() || !info.isReadable()) {
+      return profiles;
+    }
+    QSettings settings(path, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+      return profiles;
+    }
+    for (const QString& key : settings.childKeys()) {
+      profiles[""][key] = settings.value(key);
+    }
+    for (const QString& group : settings.childGroups()) {
+      settings.beginGroup(group);
+      for (const QString& key : settings.allKeys()) {
+        profiles[group][key] = settings.value(key);
+      }
+      settings.endGroup();
+    }
+  }
+  *ok = true;
+  return profiles;
+}
+
+MpvPlayerOptions resolveProfile(const QMap<QString, QVariantMap>& profiles,
+                                const QString& name, int depth, bool* ok) {
+  if (!profiles.contains(name)) {
+    return MpvPlayerOptions::builtinProfile(name, ok);
+  }
+
+  QVariantMap options = profiles[name];
+  QString base = options.take(kBaseKey).toString();
+  if (base.isEmpty()) {
+    base = kDefaultProfile;
+  }
+
+  MpvPlayerOptions result;
+  if (depth >= kMaxBaseDepth) {
+    *ok = false;
+  } else if (base == name) {
+    result = MpvPlayerOptions::builtinProfile(base, ok);
+  } else {
+    result = resolveProfile(profiles, base, depth + 1, ok);
+  }
+  result.merge(MpvPlayerOptions(options));
+  result.setName(name);
+  return result;
+}
+
+QMutex defaults_mutex;
+MpvPlayerOptions* defaults_ = nullptr;
+}  // namespace
+
+MpvPlayerOptions::MpvPlayerOptions(const QVariantMap& options,
+                                   const QString& name)
+    : name_(name), options_(options) {}
+
+QStringList MpvPlayerOptions::builtinProfiles() {
+  return builtinProfileOptions().keys();
+}
+
+MpvPlayerOptions MpvPlayerOptions::builtinProfile(const QString& name,
+                                                  bool* ok) {
+  const QMap<QString, QVariantMap>& profiles = builtinProfileOptions();
+  bool found = profiles.contains(name);
+  if (ok) {
+    *ok = found;
+  }
+
+  MpvPlayerOptions options(defaultOptions(), name);
+  if (found) {
+    options.merge(MpvPlayerOptions(profiles[name]));
+  }
+  return options;
+}
+
+MpvPlayerOptions MpvPlayerOptions::fromFile(const QString& path,
+                                            const QString& profile,
+                                            bool* ok) {
+  bool success = false;
+  QMap<QString, QVariantMap> profiles = readProfiles(path, &success);
+  MpvPlayerOptions options;
+  if (success) {
+    options = resolveProfile(profiles, profile, 0, &success);
+  }
+  if (ok) {
+    *ok = success;
+  }
+  return options;
+}
+
+MpvPlayerOptions MpvPlayerOptions::defaults() {
+  QMutexLocker locker(&defaults_mutex);
+  return defaults_ ? *defaults_ : builtinProfile(kDefaultProfile);
+}
+
+void MpvPlayerOptions::setDefaults(const MpvPlayerOptions& options) {
+  QMutexLocker locker(&defaults_mutex);
+  if (defaults_) {
+    *defaults_ = options;
+  } else {
+    defaults_ = new MpvPlayerOptions(options);
+  }
+}
+
+QString MpvPlayerOptions::name() const { return name_; }
+
+void MpvPlayerOptions::setName(const QString& name) { name_ = name; }
+
+bool MpvPlayerOptions::isEmpty() const { return options_.isEmpty(); }
+
+bool MpvPlayerOptions::contains(const QString& option) const {
+  return options_.contains(option);
+}
+
+QVariant MpvPlayerOptions::value(const QString& option) const {
+  return options_.value(option);
+}
+
+MpvPlayerOptions& MpvPlayerOptions::set(const QString& option,
+                                        const QVariant& value) {
+  options_[option] = value;
+  return *this;
+}
+
+MpvPlayerOptions& MpvPlayerOptions::remove(const QString& option) {
+  options_.remove(option);
+  return *this;
+}
+
+QVariantMap MpvPlayerOptions::options() const { return options_; }
+
+MpvPlayerOptions& MpvPlayerOptions::merge(const MpvPlayerOptions& other) {
+  for (auto it = other.options_.cbegin(); it != other.options_.cend(); ++it) {
+    options_[it.key()] = it.value();
+  }
+  return *this;
+}
+
+QList<QPair<QByteArray, QByteArray>> MpvPlayerOptions::toMpvOptions() const {
+  QList<QPair<QByteArray, QByteArray>> options;
+  for (auto it = options_.cbegin(); it != options_.cend(); ++it) {
+    QPair<QByteArray, QByteArray> option{it.key().toUtf8(),
+                                         toOptionString(it.value())};
+    if (option.first == "profile") {
+      options.prepend(option);
+    } else {
+      options.append(option);
+    }
+  }
+  return options;
+}
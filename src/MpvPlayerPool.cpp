@@ -0,0 +1,123 @@
+#include "MpvPlayerPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "MpvResourceGovernor.hpp"
+
+namespace {
+void setPlayerVisible(MpvPlayer* player, bool visible) {
+  if (QWidget* widget = dynamic_cast<QWidget*>(player)) {
+    // Parentless widgets would pop up as top-level windows, leave them to the
+    // layout they are inserted into
+    if (!visible || widget->parentWidget()) {
+      widget->setVisible(visible);
+    }
+  } else if (QQuickItem* item = dynamic_cast<QQuickItem*>(player)) {
+    item->setVisible(visible);
+  }
+}
+}  // namespace
+
+MpvPlayerPool::MpvPlayerPool(const Factory& factory, int capacity,
+                             QObject* parent)
+    : QObject(parent), factory_(factory), capacity_(std::max(capacity, 0)) {}
+
+MpvPlayerPool::~MpvPlayerPool() {
+  while (!idle_.isEmpty()) {
+    destroy(take());
+  }
+}
+
+int MpvPlayerPool::capacity() const { return capacity_; }
+
+void MpvPlayerPool::setCapacity(int capacity) {
+  capacity_ = std::max(capacity, 0);
+  while (idle_.size() > capacity_) {
+    destroy(take());
+  }
+}
+
+int MpvPlayerPool::idleCount() const { return idle_.size(); }
+
+MpvPlayer* MpvPlayerPool::acquire(const QString& name) {
+  MpvPlayer* player = idle_.isEmpty() ? create() : take();
+  if (!player) {
+    return nullptr;
+  }
+  if (!name.isEmpty()) {
+    player->setName(name);
+  }
+  setPlayerVisible(player, true);
+  return player;
+}
+
+void MpvPlayerPool::release(MpvPlayer* player) {
+  if (!player || idle_.contains(player)) {
+    return;
+  }
+  if (idle_.size() >= capacity_) {
+    destroy(player);
+    return;
+  }
+  player->reset();
+  keep(player);
+}
+
+void MpvPlayerPool::reserve(int count) {
+  count = std::min(count, capacity_);
+  while (idle_.size() < count) {
+    MpvPlayer* player = create();
+    if (!player) {
+      break;
+    }
+    keep(player);
+  }
+}
+
+void MpvPlayerPool::prewarm(int count) {
+  prewarm_target_ = std::min(count, capacity_);
+  QTimer::singleShot(0, this, &MpvPlayerPool::prewarmNext);
+}
+
+MpvPlayer* MpvPlayerPool::create() { return factory_ ? factory_() : nullptr; }
+
+void MpvPlayerPool::keep(MpvPlayer* player) {
+  setPlayerVisible(player, false);
+  MpvResourceGovernor::instance()->setPlayerIdle(player, true);
+  idle_ << player;
+  // An idle player deleted by its parent or the caller must not be handed out
+  QObject* object = dynamic_cast<QObject*>(player);
+  if (object && !watched_.contains(player)) {
+    watched_.insert(player);
+    connect(object, &QObject::destroyed, this, [this, player] {
+      watched_.remove(player);
+      idle_.removeAll(player);
+    });
+  }
+}
+
+MpvPlayer* MpvPlayerPool::take() {
+  MpvPlayer* player = idle_.takeLast();
+  MpvResourceGovernor::instance()->setPlayerIdle(player, false);
+  return player;
+}
+
+void MpvPlayerPool::destroy(MpvPlayer* player) {
+  if (QObject* object = dynamic_cast<QObject*>(player)) {
+    object->deleteLater();
+  } else {
+    delete player;
+  }
+}
+
+void MpvPlayerPool::prewarmNext() {
+  if (idle_.size() >= prewarm_target_) {
+    return;
+  }
+  int count = idle_.size();
+  reserve(count + 1);
+  if (idle_.size() > count && idle_.size() < prewarm_target_) {
+    QTimer::singleShot(0, this, &MpvPlayerPool::prewarmNext);
+  }
+}
@@ -0,0 +1,107 @@
+#include "MpvPlayerStats.hpp"
+
+#include <algorithm>
+
+#include "MpvPlayer.hpp"
+
+namespace {
+const QStringList kObservedProperties = {"estimated-vf-fps",
+                                         "frame-drop-count",
+                                         "decoder-frame-drop-count",
+                                         "vo-delayed-frame-count",
+                                         "video-bitrate",
+                                         "audio-bitrate",
+                                         "demuxer-cache-duration",
+                                         "demuxer-cache-state",
+                                         "video-codec",
+                                         "hwdec-current",
+                                         "avsync"};
+}  // namespace
+
+void MpvPlayerStats::observe(MpvPlayer* player) {
+  for (const QString& name : kObservedProperties) {
+    player->observePlayerProperty(name);
+  }
+}
+
+MpvPlayerStats::Snapshot MpvPlayerStats::capture(const MpvPlayer* player) {
+  // One lock for a consistent set of values
+  QVariantMap values = player->observedPlayerProperties(kObservedProperties);
+  Snapshot snapshot;
+  snapshot.fps = values.value("estimated-vf-fps").toDouble();
+  snapshot.dropped_frames =
+      values.value("frame-drop-count").toLongLong() +
+      values.value("decoder-frame-drop-count").toLongLong();
+  snapshot.delayed_frames = values.value("vo-delayed-frame-count").toLongLong();
+  snapshot.video_bitrate = values.value("video-bitrate").toDouble();
+  snapshot.audio_bitrate = values.value("audio-bitrate").toDouble();
+  snapshot.cache_duration = values.value("demuxer-cache-duration").toDouble();
+  snapshot.cache_bytes = values.value("demuxer-cache-state")
+                             .toMap()
+                             .value("fw-bytes")
+                             .toLongLong();
+  snapshot.decoder = values.value("video-codec").toString();
+  QString hwdec = values.value("hwdec-current").toString();
+  snapshot.hwdec = hwdec == "no" ? QString() : hwdec;
+  snapshot.av_sync = values.value("avsync").toDouble();
+  return snapshot;
+}
+
+MpvPlayerStats::MpvPlayerStats(MpvPlayer* player, QObject* parent)
+    : QObject(parent), player_(player) {
+  connect(&timer_, &QTimer::timeout, this, &MpvPlayerStats::update);
+}
+
+MpvPlayerStats::~MpvPlayerStats() = default;
+
+int MpvPlayerStats::interval() const {
+  return timer_.isActive() ? timer_.interval() : 0;
+}
+
+void MpvPlayerStats::setInterval(int msec) {
+  msec = std::max(msec, 0);
+  if (msec == interval()) {
+    return;
+  }
+  if (msec > 0) {
+    observe(player_);
+    timer_.start(msec);
+    update();
+  } else {
+    timer_.stop();
+  }
+  emit intervalChanged(msec);
+}
+
+MpvPlayerStats::Snapshot MpvPlayerStats::snapshot() const { return snapshot_; }
+
+double MpvPlayerStats::fps() const { return snapshot_.fps; }
+
+qint64 MpvPlayerStats::droppedFrames() const {
+  return snapshot_.dropped_frames;
+}
+
+qint64 MpvPlayerStats::delayedFrames() const {
+  return snapshot_.delayed_frames;
+}
+
+double MpvPlayerStats::videoBitrate() const { return snapshot_.video_bitrate; }
+
+double MpvPlayerStats::audioBitrate() const { return snapshot_.audio_bitrate; }
+
+double MpvPlayerStats::cacheDuration() const {
+  return snapshot_.cache_duration;
+}
+
+qint64 MpvPlayerStats::cacheBytes() const { return snapshot_.cache_bytes; }
+
+QString MpvPlayerStats::decoder() const { return snapshot_.decoder; }
+
+QString MpvPlayerStats::hwdec() const { return snapshot_.hwdec; }
+
+double MpvPlayerStats::avSync() const { return snapshot_.av_sync; }
+
+void MpvPlayerStats::update() {
+  snapshot_ = capture(player_);
+  emit updated();
+}
@@ -0,0 +1,112 @@
+#include "MpvQualityManager.hpp"
+
+#include <algorithm>
+
+MpvQualityManager::MpvQualityManager(QObject* parent) : QObject(parent) {}
+
+MpvQualityManager::~MpvQualityManager() = default;
+
+void MpvQualityManager::addPlayer(MpvPlayer* player) {
+  if (!player || players_.contains(player)) {
+    return;
+  }
+  players_ << player;
+
+  if (QWidget* widget = dynamic_cast<QWidget*>(player)) {
+    widget->installEventFilter(this);
+  } else if (QQuickItem* item = dynamic_cast<QQuickItem*>(player)) {
+    connect(item, &QQuickItem::widthChanged, this,
+            &MpvQualityManager::scheduleUpdate);
+    connect(item, &QQuickItem::heightChanged, this,
+            &MpvQualityManager::scheduleUpdate);
+  }
+  if (QObject* object = dynamic_cast<QObject*>(player)) {
+    // The player is already destroyed, only forget it
+    connect(object, &QObject::destroyed, this, [this, player] {
+      players_.removeAll(player);
+      if (focused_player_ == player) {
+        focused_player_ = nullptr;
+      }
+    });
+  }
+  scheduleUpdate();
+}
+
+void MpvQualityManager::removePlayer(MpvPlayer* player) {
+  if (players_.removeAll(player) == 0) {
+    return;
+  }
+  if (focused_player_ == player) {
+    focused_player_ = nullptr;
+  }
+  if (QObject* object = dynamic_cast<QObject*>(player)) {
+    object->removeEventFilter(this);
+    disconnect(object, nullptr, this, nullptr);
+  }
+}
+
+QList<MpvPlayer*> MpvQualityManager::players() const { return players_; }
+
+MpvPlayer* MpvQualityManager::focusedPlayer() const { return focused_player_; }
+
+void MpvQualityManager::setFocusedPlayer(MpvPlayer* player) {
+  if (player != focused_player_ && (!player || players_.contains(player))) {
+    focused_player_ = player;
+    scheduleUpdate();
+  }
+}
+
+int MpvQualityManager::fullQualityHeight() const { return full_height_; }
+
+int MpvQualityManager::balancedQualityHeight() const {
+  return balanced_height_;
+}
+
+int MpvQualityManager::tileQualityHeight() const { return tile_height_; }
+
+void MpvQualityManager::setHeightThresholds(int full, int balanced,
+                                            int tile) {
+  full_height_ = std::max(full, 0);
+  balanced_height_ = std::clamp(balanced, 0, full_height_);
+  tile_height_ = std::clamp(tile, 0, balanced_height_);
+  scheduleUpdate();
+}
+
+MpvPlayer::QualityLevel MpvQualityManager::qualityLevelFor(
+    MpvPlayer* player) const {
+  int height = player->surfaceSize().height();
+  if (player == focused_player_ || height >= full_height_) {
+    return MpvPlayer::FullQuality;
+  } else if (height >= balanced_height_) {
+    return MpvPlayer::BalancedQuality;
+  } else if (height >= tile_height_) {
+    return MpvPlayer::TileQuality;
+  } else {
+    return MpvPlayer::ThumbnailQuality;
+  }
+}
+
+void MpvQualityManager::update() {
+  update_pending_ = false;
+  for (MpvPlayer* player : players_) {
+    MpvPlayer::QualityLevel level = qualityLevelFor(player);
+    if (level != player->qualityLevel()) {
+      player->setQualityLevel(level);
+      emit qualityLevelChanged(player, level);
+    }
+  }
+}
+
+bool MpvQualityManager::eventFilter(QObject* watched, QEvent* event) {
+  if (event->type() == QEvent::Resize) {
+    scheduleUpdate();
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+void MpvQualityManager::scheduleUpdate() {
+  if (!update_pending_) {
+    update_pending_ = true;
+    QTimer::singleShot(0, this, &MpvQualityManager::update);
+  }
+}
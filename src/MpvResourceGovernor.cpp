@@ -0,0 +1,172 @@
+#include "MpvResourceGovernor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace {
+// Wait for bursts of players being created or resized to settle, changing the
+// decoder thread count reinitializes the decoder
+constexpr int kRebalanceDelay = 200;
+}  // namespace
+
+MpvResourceGovernor* MpvResourceGovernor::instance() {
+  // Never destroyed, players may outlive static destruction order
+  static MpvResourceGovernor* governor = new MpvResourceGovernor;
+  return governor;
+}
+
+MpvResourceGovernor::MpvResourceGovernor()
+    : thread_budget_(std::max(QThread::idealThreadCount(), 1)) {
+  rebalance_timer_.setSingleShot(true);
+  rebalance_timer_.setInterval(kRebalanceDelay);
+  connect(&rebalance_timer_, &QTimer::timeout, this,
+          &MpvResourceGovernor::rebalance);
+}
+
+bool MpvResourceGovernor::isEnabled() const { return enabled_; }
+
+void MpvResourceGovernor::setEnabled(bool enabled) {
+  if (enabled != enabled_) {
+    enabled_ = enabled;
+    rebalance();
+  }
+}
+
+int MpvResourceGovernor::threadBudget() const { return thread_budget_; }
+
+void MpvResourceGovernor::setThreadBudget(int threads) {
+  threads = std::max(threads, 1);
+  if (threads != thread_budget_) {
+    thread_budget_ = threads;
+    scheduleRebalance();
+  }
+}
+
+qint64 MpvResourceGovernor::cacheBudget() const { return cache_budget_; }
+
+void MpvResourceGovernor::setCacheBudget(qint64 bytes) {
+  bytes = std::max<qint64>(bytes, 0);
+  if (bytes != cache_budget_) {
+    cache_budget_ = bytes;
+    scheduleRebalance();
+  }
+}
+
+double MpvResourceGovernor::focusWeight() const { return focus_weight_; }
+
+void MpvResourceGovernor::setFocusWeight(double weight) {
+  weight = std::max(weight, 1.0);
+  if (weight != focus_weight_) {
+    focus_weight_ = weight;
+    scheduleRebalance();
+  }
+}
+
+MpvPlayer* MpvResourceGovernor::focusedPlayer() const {
+  return focused_player_;
+}
+
+void MpvResourceGovernor::setFocusedPlayer(MpvPlayer* player) {
+  if (player != focused_player_ && (!player || players_.contains(player))) {
+    focused_player_ = player;
+    scheduleRebalance();
+  }
+}
+
+QList<MpvPlayer*> MpvResourceGovernor::players() const { return players_; }
+
+bool MpvResourceGovernor::isPlayerIdle(MpvPlayer* player) const {
+  return idle_players_.contains(player);
+}
+
+void MpvResourceGovernor::setPlayerIdle(MpvPlayer* player, bool idle) {
+  if (!players_.contains(player) || idle == idle_players_.contains(player)) {
+    return;
+  }
+  if (idle) {
+    idle_players_.insert(player);
+  } else {
+    idle_players_.remove(player);
+  }
+  scheduleRebalance();
+}
+
+void MpvResourceGovernor::rebalance() {
+  rebalance_timer_.stop();
+  QList<MpvPlayer*> players;
+  for (MpvPlayer* player : players_) {
+    if (!idle_players_.contains(player)) {
+      players << player;
+    }
+  }
+  if (players.isEmpty()) {
+    return;
+  }
+  if (!enabled_) {
+    for (MpvPlayer* player : players) {
+      player->setDecoderThreads(0);
+      player->setCacheLimit(0);
+    }
+    return;
+  }
+
+  // Caches fill up regardless of the tile size, split memory evenly
+  for (MpvPlayer* player : players) {
+    player->setCacheLimit(cache_budget_ / players.size());
+  }
+
+  // Weight tiles by their area relative to the average tile, so the largest
+  // tile gets more threads
+  std::vector<double> areas;
+  areas.reserve(players.size());
+  for (MpvPlayer* player : players) {
+    QSize size = player->surfaceSize();
+    areas.push_back(std::max(size.width(), 1) * std::max(size.height(), 1));
+  }
+  double mean_area =
+      std::accumulate(areas.cbegin(), areas.cend(), 0.0) / areas.size();
+
+  std::vector<double> weights;
+  weights.reserve(players.size());
+  for (int i = 0; i < players.size(); ++i) {
+    double weight = std::max(areas[i] / mean_area, 1.0);
+    if (players[i] == focused_player_) {
+      weight *= focus_weight_;
+    }
+    weights.push_back(weight);
+  }
+  double total_weight =
+      std::accumulate(weights.cbegin(), weights.cend(), 0.0);
+
+  for (int i = 0; i < players.size(); ++i) {
+    int threads = static_cast<int>(
+        std::floor(thread_budget_ * weights[i] / total_weight));
+    players[i]->setDecoderThreads(std::max(threads, 1));
+  }
+}
+
+void MpvResourceGovernor::addPlayer(MpvPlayer* player) {
+  if (!players_.contains(player)) {
+    players_ << player;
+    scheduleRebalance();
+  }
+}
+
+void MpvResourceGovernor::removePlayer(MpvPlayer* player) {
+  if (players_.removeAll(player) > 0) {
+    idle_players_.remove(player);
+    if (focused_player_ == player) {
+      focused_player_ = nullptr;
+    }
+    scheduleRebalance();
+  }
+}
+
+void MpvResourceGovernor::playerResized(MpvPlayer* player) {
+  Q_UNUSED(player)
+  scheduleRebalance();
+}
+
+void MpvResourceGovernor::scheduleRebalance() { rebalance_timer_.start(); }
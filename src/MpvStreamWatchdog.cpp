@@ -0,0 +1,191 @@
+#include "MpvStreamWatchdog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#include "MpvMetrics.hpp"
+#include "MpvResourceGovernor.hpp"
+
+namespace {
+const char* const kObservedProperties[] = {"idle-active",
+                                           "demuxer-cache-state"};
+}  // namespace
+
+MpvStreamWatchdog::MpvStreamWatchdog(QObject* parent) : QObject(parent) {
+  timer_.setInterval(1000);
+  connect(&timer_, &QTimer::timeout, this, &MpvStreamWatchdog::sample);
+}
+
+MpvStreamWatchdog::~MpvStreamWatchdog() { stop(); }
+
+bool MpvStreamWatchdog::isRunning() const { return timer_.isActive(); }
+
+void MpvStreamWatchdog::start() {
+  if (!timer_.isActive()) {
+    clock_.start();
+    timer_.start();
+  }
+}
+
+void MpvStreamWatchdog::stop() {
+  timer_.stop();
+  for (const Watch& watch : std::as_const(watches_)) {
+    disconnect(watch.file_ended);
+  }
+  watches_.clear();
+  errors_.clear();
+}
+
+int MpvStreamWatchdog::interval() const { return timer_.interval(); }
+
+void MpvStreamWatchdog::setInterval(int msec) { timer_.setInterval(msec); }
+
+int MpvStreamWatchdog::stallTimeout() const { return stall_timeout_; }
+
+void MpvStreamWatchdog::setStallTimeout(int msec) {
+  stall_timeout_ = std::max(msec, 0);
+}
+
+int MpvStreamWatchdog::reconnectDelay() const { return reconnect_delay_; }
+
+void MpvStreamWatchdog::setReconnectDelay(int msec) {
+  reconnect_delay_ = std::max(msec, 0);
+}
+
+int MpvStreamWatchdog::maxReconnectDelay() const {
+  return max_reconnect_delay_;
+}
+
+void MpvStreamWatchdog::setMaxReconnectDelay(int msec) {
+  max_reconnect_delay_ = std::max(msec, 0);
+}
+
+double MpvStreamWatchdog::jitter() const { return jitter_; }
+
+void MpvStreamWatchdog::setJitter(double ratio) {
+  jitter_ = std::clamp(ratio, 0.0, 1.0);
+}
+
+bool MpvStreamWatchdog::isStalled(MpvPlayer* player) const {
+  auto it = watches_.constFind(player);
+  return it != watches_.cend() && it->stall_time >= 0;
+}
+
+int MpvStreamWatchdog::reconnectCount() const { return reconnect_count_; }
+
+void MpvStreamWatchdog::sample() {
+  qint64 now = clock_.elapsed();
+  QList<MpvPlayer*> players = MpvResourceGovernor::instance()->players();
+  QSet<QObject*> errors = std::exchange(errors_, {});
+
+  // Forget destroyed players, without touching them
+  for (auto it = watches_.begin(); it != watches_.end();) {
+    it = players.contains(it.key()) ? std::next(it) : watches_.erase(it);
+  }
+
+  for (MpvPlayer* player : players) {
+    QObject* object = dynamic_cast<QObject*>(player);
+    Watch& watch = watches_[player];
+    if (!watch.file_ended) {
+      watch = Watch{};
+      for (const char* name : kObservedProperties) {
+        player->observePlayerProperty(name);
+      }
+      watch.file_ended =
+          connect(object, SIGNAL(fileEnded(int, QString)), this,
+                  SLOT(onFileEnded(int, QString)));
+      progressed(player, watch);
+      watch.progress_time = now;
+      continue;
+    }
+
+    bool error = errors.contains(object);
+    bool progress = progressed(player, watch);
+    int index = player->playlistIndex();
+    if (index >= 0) {
+      watch.playlist_index = index;
+    }
+    MpvPlayer::PlayState state = player->playState();
+    // Loading or playing a url, an error leaves the player idle
+    bool active = !player->url().isEmpty() &&
+                  (state == MpvPlayer::Play || state == MpvPlayer::Stop) &&
+                  (error || !player->observedPlayerProperty("idle-active")
+                                 .toBool());
+
+    if (!active || (progress && !error)) {
+      if (watch.stall_time >= 0) {
+        emit recovered(player, now - watch.stall_time);
+      }
+      watch.stall_time = -1;
+      watch.attempts = 0;
+      watch.progress_time = now;
+      continue;
+    }
+
+    if (watch.stall_time < 0) {
+      if (!error && now - watch.progress_time < stall_timeout_) {
+        continue;
+      }
+      watch.stall_time = error ? now : watch.progress_time;
+      // Sources lost at once are detected in the same sample, spread their
+      // first attempts too
+      watch.next_attempt = now + qint64(reconnect_delay_ * jitter_ *
+                                        QRandomGenerator::global()
+                                            ->generateDouble());
+      emit stalled(player, now - watch.stall_time);
+    }
+    if (now >= watch.next_attempt) {
+      reconnect(player, watch, now);
+    }
+  }
+}
+
+bool MpvStreamWatchdog::progressed(MpvPlayer* player, Watch& watch) const {
+  bool progress = false;
+  qint64 frame_time = player->lastFrameTime();
+  if (frame_time != watch.frame_time) {
+    watch.frame_time = frame_time;
+    progress = true;
+  }
+  // Unavailable while a reload is in progress, which is not progress
+  for (auto marker :
+       {std::make_pair(player->observedPlayerProperty("time-pos"),
+                       &watch.position),
+        std::make_pair(player->cacheState().value("cache-end"),
+                       &watch.cache_end)}) {
+    if (marker.first.isValid() && marker.first != *marker.second) {
+      *marker.second = marker.first;
+      progress = true;
+    }
+  }
+  return progress;
+}
+
+void MpvStreamWatchdog::reconnect(MpvPlayer* player, Watch& watch,
+                                  qint64 now) {
+  ++watch.attempts;
+  ++reconnect_count_;
+  MpvMetrics::instance().reconnects.add();
+  double delay = std::min(
+      reconnect_delay_ * std::pow(2.0, std::min(watch.attempts - 1, 30)),
+      double(max_reconnect_delay_));
+  delay *= 1 + jitter_ * (2 * QRandomGenerator::global()->generateDouble() -
+                          1);
+  // A load without progress fails after stallTimeout()
+  watch.next_attempt = now + std::max(qint64(delay), qint64(stall_timeout_));
+  emit reconnecting(player, watch.attempts);
+  // setUrl() would replace a playlist with its first entry
+  if (watch.playlist_index >= 0 && player->playlist().size() > 1) {
+    player->setPlaylistIndex(watch.playlist_index);
+  } else {
+    player->setUrl(player->url());
+  }
+}
+
+void MpvStreamWatchdog::onFileEnded(int reason, const QString&) {
+  if (reason == MpvPlayer::EndError) {
+    errors_.insert(sender());
+  }
+}
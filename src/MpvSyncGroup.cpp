@@ -0,0 +1,269 @@
+#include "MpvSyncGroup.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Members not ready after this are started anyway
+constexpr qint64 kStartTimeout = 5000;
+// A member is ready once it reports a position this close to the target
+constexpr double kStartTolerance = 0.5;
+// Time in seconds a speed correction should take to cancel the drift
+constexpr double kCorrectionTime = 1.0;
+// Nanoseconds a position is extrapolated at most, older positions are of a
+// stalled member
+constexpr qint64 kMaxExtrapolation = 100000000;
+
+bool isSeeking(MpvPlayer* player) {
+  return player->observedPlayerProperty("seeking").toBool();
+}
+
+// time-pos extrapolated to now at the speed of the player. Members report
+// positions at different times, up to a frame apart, which is as much as the
+// tolerance.
+QVariant currentPosition(MpvPlayer* player, double speed) {
+  qint64 age = -1;
+  QVariant position = player->observedPlayerProperty("time-pos", &age);
+  if (!position.isValid() || age < 0) {
+    return QVariant();
+  }
+  return position.toDouble() + std::min(age, kMaxExtrapolation) / 1e9 * speed;
+}
+}  // namespace
+
+MpvSyncGroup::MpvSyncGroup(QObject* parent) : QObject(parent) {
+  timer_.setInterval(200);
+  connect(&timer_, &QTimer::timeout, this, &MpvSyncGroup::synchronize);
+}
+
+MpvSyncGroup::~MpvSyncGroup() = default;
+
+void MpvSyncGroup::addPlayer(MpvPlayer* player, double offset) {
+  if (!player || member(player)) {
+    return;
+  }
+  player->observePlayerProperty("time-pos");
+  player->observePlayerProperty("seeking");
+
+  Member member;
+  member.player = player;
+  member.offset = offset;
+  double speed = player->getPlayerProperty<double>("speed");
+  member.initial_speed = speed > 0 ? speed : 1;
+  member.speed = member.initial_speed;
+  members_ << member;
+  if (!master_) {
+    master_ = player;
+  }
+
+  if (QObject* object = dynamic_cast<QObject*>(player)) {
+    connect(object, &QObject::destroyed, this,
+            [this, player] { forget(player); });
+  }
+}
+
+void MpvSyncGroup::removePlayer(MpvPlayer* player) {
+  // Take back the corrections of the group
+  if (Member* removed = member(player)) {
+    setMemberSpeed(*removed, removed->initial_speed);
+  }
+  if (QObject* object = dynamic_cast<QObject*>(player)) {
+    disconnect(object, &QObject::destroyed, this, nullptr);
+  }
+  forget(player);
+}
+
+void MpvSyncGroup::forget(MpvPlayer* player) {
+  members_.erase(std::remove_if(members_.begin(), members_.end(),
+                                [player](const Member& member) {
+                                  return member.player == player;
+                                }),
+                 members_.end());
+  if (master_ == player) {
+    master_ = members_.isEmpty() ? nullptr : members_.first().player;
+  }
+  if (members_.isEmpty()) {
+    timer_.stop();
+  }
+}
+
+QList<MpvPlayer*> MpvSyncGroup::players() const {
+  QList<MpvPlayer*> players;
+  for (const Member& member : members_) {
+    players << member.player;
+  }
+  return players;
+}
+
+MpvPlayer* MpvSyncGroup::master() const { return master_; }
+
+void MpvSyncGroup::setMaster(MpvPlayer* player) {
+  if (member(player)) {
+    master_ = player;
+    setMemberSpeed(*member(player), speed_);
+  }
+}
+
+double MpvSyncGroup::tolerance() const { return tolerance_; }
+
+void MpvSyncGroup::setTolerance(double seconds) {
+  tolerance_ = std::max(seconds, 0.0);
+}
+
+double MpvSyncGroup::seekThreshold() const { return seek_threshold_; }
+
+void MpvSyncGroup::setSeekThreshold(double seconds) {
+  seek_threshold_ = std::max(seconds, tolerance_);
+}
+
+double MpvSyncGroup::maxSpeedCorrection() const {
+  return max_speed_correction_;
+}
+
+void MpvSyncGroup::setMaxSpeedCorrection(double ratio) {
+  max_speed_correction_ = std::clamp(ratio, 0.0, 0.5);
+}
+
+int MpvSyncGroup::interval() const { return timer_.interval(); }
+
+void MpvSyncGroup::setInterval(int msec) { timer_.setInterval(msec); }
+
+double MpvSyncGroup::position() const {
+  if (!master_) {
+    return 0;
+  }
+  for (const Member& member : members_) {
+    if (member.player == master_) {
+      return master_->observedPlayerProperty("time-pos").toDouble() -
+             member.offset;
+    }
+  }
+  return 0;
+}
+
+double MpvSyncGroup::speed() const { return speed_; }
+
+bool MpvSyncGroup::isPaused() const { return paused_; }
+
+void MpvSyncGroup::play() {
+  starting_ = false;
+  paused_ = false;
+  for (Member& member : members_) {
+    setMemberSpeed(member, speed_);
+    member.player->resume();
+  }
+  timer_.start();
+}
+
+void MpvSyncGroup::pause() {
+  starting_ = false;
+  paused_ = true;
+  timer_.stop();
+  for (const Member& member : members_) {
+    member.player->pause();
+  }
+}
+
+void MpvSyncGroup::seek(double position) {
+  for (Member& member : members_) {
+    seekMember(member, position);
+  }
+}
+
+void MpvSyncGroup::setSpeed(double speed) {
+  if (speed <= 0) {
+    return;
+  }
+  speed_ = speed;
+  for (Member& member : members_) {
+    setMemberSpeed(member, speed_);
+  }
+}
+
+void MpvSyncGroup::start(double position) {
+  pause();
+  seek(position);
+  starting_ = true;
+  start_position_ = position;
+  start_timer_.start();
+  timer_.start();
+}
+
+MpvSyncGroup::Member* MpvSyncGroup::member(MpvPlayer* player) {
+  for (Member& member : members_) {
+    if (member.player == player) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+void MpvSyncGroup::seekMember(Member& member, double position) {
+  // Queued, so that resynchronizing many members does not block the GUI
+  member.player->playerCommandAsync("seek", position + member.offset,
+                                    "absolute+exact");
+}
+
+void MpvSyncGroup::setMemberSpeed(Member& member, double speed) {
+  if (member.speed != speed) {
+    member.speed = speed;
+    member.player->setPlayerProperty("speed", speed);
+  }
+}
+
+void MpvSyncGroup::synchronize() {
+  if (starting_) {
+    finishStart();
+    return;
+  }
+  if (paused_ || !master_) {
+    return;
+  }
+
+  Member* master = member(master_);
+  QVariant master_position = currentPosition(master_, master->speed);
+  if (!master_position.isValid() || isSeeking(master_)) {
+    return;
+  }
+  double clock = master_position.toDouble() - master->offset;
+
+  for (Member& member : members_) {
+    if (member.player == master_) {
+      continue;
+    }
+    QVariant position = currentPosition(member.player, member.speed);
+    if (!position.isValid() || isSeeking(member.player)) {
+      continue;
+    }
+
+    double drift = position.toDouble() - member.offset - clock;
+    if (std::abs(drift) > seek_threshold_) {
+      setMemberSpeed(member, speed_);
+      seekMember(member, clock);
+      emit resynchronized(member.player, drift);
+    } else if (std::abs(drift) > tolerance_) {
+      // Cancel the drift over kCorrectionTime, ahead members slow down
+      double correction =
+          std::clamp(-drift / kCorrectionTime, -max_speed_correction_,
+                     max_speed_correction_);
+      setMemberSpeed(member, speed_ * (1 + correction));
+    } else {
+      setMemberSpeed(member, speed_);
+    }
+  }
+}
+
+void MpvSyncGroup::finishStart() {
+  bool ready = std::all_of(
+      members_.cbegin(), members_.cend(), [this](const Member& member) {
+        QVariant position = member.player->observedPlayerProperty("time-pos");
+        return position.isValid() && !isSeeking(member.player) &&
+               std::abs(position.toDouble() - member.offset -
+                        start_position_) < kStartTolerance;
+      });
+  if (!ready && start_timer_.elapsed() < kStartTimeout) {
+    return;
+  }
+  play();
+  emit started();
+}
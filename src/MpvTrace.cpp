@@ -0,0 +1,223 @@
+#include "MpvTrace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+qint64 monotonicNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Record {
+  const char* name;
+  qint64 begin;
+  qint64 duration;
+  char detail[48];
+};
+
+// Written by its thread only, read by write() up to the published size
+struct Buffer {
+  Buffer(int capacity, int tid, const QString& name)
+      : records(new Record[capacity]),
+        capacity(capacity),
+        tid(tid),
+        thread_name(name) {}
+
+  std::unique_ptr<Record[]> records;
+  const int capacity;
+  std::atomic_int size{0};
+  std::atomic<qint64> dropped{0};
+  const int tid;
+  QString thread_name;
+};
+
+// Buffers of the current capture. Threads pick up a new buffer when the
+// generation changes, and share the ownership of their buffer, so that it
+// stays alive while they write to it after a new capture started.
+class Registry {
+ public:
+  static Registry& instance() {
+    // Leaked, threads may record during static destruction
+    static Registry* registry = new Registry;
+    return *registry;
+  }
+
+  void start(int capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.clear();
+    capacity_ = std::max(capacity, 1);
+    origin_ = monotonicNanoseconds();
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+
+  // Buffer of the calling thread in the current capture
+  Buffer* buffer() {
+    int generation = generation_.load(std::memory_order_acquire);
+    if (buffer_generation_ != generation) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      int tid = int(buffers_.size()) + 1;
+      buffer_ = std::make_shared<Buffer>(
+          capacity_, tid,
+          thread_name_.isEmpty() ? QString("thread %1").arg(tid)
+                                 : thread_name_);
+      buffers_.push_back(buffer_);
+      buffer_generation_ = generation;
+    }
+    return buffer_.get();
+  }
+
+  void setThreadName(const QString& name) {
+    thread_name_ = name;
+    if (buffer_generation_ == generation_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffer_->thread_name = name;
+    }
+  }
+
+  template <typename Function>
+  void forEach(const Function& function) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) {
+      function(*buffer, origin_);
+    }
+  }
+
+ private:
+  Registry() = default;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Buffer>> buffers_{};
+  std::atomic_int generation_{0};
+  int capacity_ = 0;
+  qint64 origin_ = 0;
+  static thread_local QString thread_name_;
+  static thread_local std::shared_ptr<Buffer> buffer_;
+  static thread_local int buffer_generation_;
+};
+
+thread_local QString Registry::thread_name_{};
+thread_local std::shared_ptr<Buffer> Registry::buffer_{};
+thread_local int Registry::buffer_generation_ = 0;
+
+QByteArray jsonString(const char* text) {
+  QByteArray escaped = "\"";
+  for (const char* c = text; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      escaped += '\\';
+      escaped += *c;
+    } else if (uchar(*c) < 0x20) {
+      escaped += QByteArray("\\u00") + QByteArray::number(uchar(*c), 16)
+                                           .rightJustified(2, '0');
+    } else {
+      escaped += *c;
+    }
+  }
+  return escaped + '"';
+}
+}  // namespace
+
+void MpvTrace::start(int spans_per_thread) {
+  running_.store(false, std::memory_order_relaxed);
+  Registry::instance().start(spans_per_thread);
+  running_.store(true, std::memory_order_relaxed);
+}
+
+void MpvTrace::stop() { running_.store(false, std::memory_order_relaxed); }
+
+bool MpvTrace::write(const QString& path) {
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Cannot write trace to" << path << file.errorString();
+    return false;
+  }
+
+  qint64 pid = QCoreApplication::applicationPid();
+  QByteArray separator = "\n";
+  file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  Registry::instance().forEach([&](const Buffer& buffer, qint64 origin) {
+    QByteArray thread = ",\"pid\":" + QByteArray::number(pid) +
+                        ",\"tid\":" + QByteArray::number(buffer.tid);
+    file.write(separator + "{\"name\":\"thread_name\",\"ph\":\"M\"" + thread +
+               ",\"args\":{\"name\":" +
+               jsonString(buffer.thread_name.toUtf8().constData()) + "}}");
+    separator = ",\n";
+    int size = buffer.size.load(std::memory_order_acquire);
+    for (int i = 0; i < size; ++i) {
+      const Record& record = buffer.records[i];
+      QByteArray event = separator + "{\"name\":" + jsonString(record.name) +
+                         ",\"cat\":\"mpv\",\"ph\":\"X\",\"ts\":" +
+                         QByteArray::number((record.begin - origin) / 1e3,
+                                            'f', 3) +
+                         ",\"dur\":" +
+                         QByteArray::number(record.duration / 1e3, 'f', 3) +
+                         thread;
+      if (record.detail[0]) {
+        event += ",\"args\":{\"detail\":" + jsonString(record.detail) + '}';
+      }
+      file.write(event + '}');
+    }
+  });
+  file.write("\n]}\n");
+  return file.commit();
+}
+
+qint64 MpvTrace::droppedSpans() {
+  qint64 dropped = 0;
+  Registry::instance().forEach([&](const Buffer& buffer, qint64) {
+    dropped += buffer.dropped.load(std::memory_order_relaxed);
+  });
+  return dropped;
+}
+
+void MpvTrace::setThreadName(const QString& name) {
+  Registry::instance().setThreadName(name);
+}
+
+void MpvTrace::Span::setDetail(const char* detail) {
+  if (begin_ == 0) {
+    return;
+  }
+  size_t length = std::min(std::strlen(detail), sizeof(detail_) - 1);
+  // Truncate at a character boundary
+  if (detail[length] != '\0') {
+    while (length > 0 && (uchar(detail[length]) & 0xC0) == 0x80) {
+      --length;
+    }
+  }
+  std::memcpy(detail_, detail, length);
+  detail_[length] = '\0';
+}
+
+void MpvTrace::Span::begin(const char* name) {
+  name_ = name;
+  detail_[0] = '\0';
+  begin_ = monotonicNanoseconds();
+}
+
+void MpvTrace::Span::setCommand(const QVariant& command) {
+  QVariantList args = command.toList();
+  QVariant name = args.isEmpty() ? command : args.first();
+  setDetail(name.toString().toUtf8().constData());
+}
+
+void MpvTrace::Span::end() {
+  qint64 end = monotonicNanoseconds();
+  Buffer* buffer = Registry::instance().buffer();
+  int size = buffer->size.load(std::memory_order_relaxed);
+  if (size >= buffer->capacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Record& record = buffer->records[size];
+  record.name = name_;
+  record.begin = begin_;
+  record.duration = end - begin_;
+  std::memcpy(record.detail, detail_, sizeof(record.detail));
+  buffer->size.store(size + 1, std::memory_order_release);
+}
@@ -0,0 +1,235 @@
+#include "MpvVideoWall.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+QVariant property(const QVariant& source, const char* name) {
+  if (QObject* object = source.value<QObject*>()) {
+    return object->property(name);
+  }
+  return source.toMap().value(name);
+}
+}  // namespace
+
+MpvVideoWall::MpvVideoWall(QQuickItem* parent)
+    : QQuickItem(parent),
+      pool_([this]() -> MpvPlayer* {
+        return new MpvPlayerQuickObject("", this);
+      }) {
+  setClip(true);
+  connect(this, &QQuickItem::widthChanged, this, &QQuickItem::polish);
+  connect(this, &QQuickItem::heightChanged, this, &QQuickItem::polish);
+}
+
+// Players are children of the wall and destroyed with it
+MpvVideoWall::~MpvVideoWall() = default;
+
+QVariant MpvVideoWall::sources() const { return sources_; }
+
+void MpvVideoWall::setSources(const QVariant& sources) {
+  sources_ = sources;
+  QVariant value = sources;
+  if (value.userType() == qMetaTypeId<QJSValue>()) {
+    value = value.value<QJSValue>().toVariant();
+  }
+  QVariantList list = value.canConvert<QVariantList>()
+                          ? value.value<QVariantList>()
+                          : QVariantList{value};
+
+  for (const QMetaObject::Connection& connection :
+       std::exchange(source_connections_, {})) {
+    disconnect(connection);
+  }
+  QVector<Source> source_list;
+  for (const QVariant& item : list) {
+    Source source;
+    if (item.userType() == QMetaType::QUrl ||
+        item.userType() == QMetaType::QString) {
+      source.url = item.toUrl();
+    } else {
+      source.url = property(item, "url").toUrl();
+      source.name = property(item, "name").toString();
+      source.paused = property(item, "paused").toBool();
+      source.object = item.value<QObject*>();
+    }
+    if (source.object) {
+      const QMetaObject* meta = source.object->metaObject();
+      QMetaProperty paused = meta->property(meta->indexOfProperty("paused"));
+      if (paused.hasNotifySignal()) {
+        source_connections_ << connect(
+            source.object, paused.notifySignal(), this,
+            metaObject()->method(
+                metaObject()->indexOfSlot("sourcePausedChanged()")));
+      }
+    }
+    if (source.name.isEmpty()) {
+      source.name = QString::number(source_list.size());
+    }
+    source_list << source;
+  }
+
+  // Keep the players of cells whose source did not change
+  for (auto it = cells_.begin(); it != cells_.end();) {
+    if (it.key() < source_list.size() &&
+        it.key() < source_list_.size() &&
+        source_list[it.key()].url == source_list_[it.key()].url) {
+      ++it;
+    } else {
+      pool_.release(it->player);
+      it = cells_.erase(it);
+    }
+  }
+  source_list_ = std::move(source_list);
+  emit sourcesChanged();
+  polish();
+}
+
+int MpvVideoWall::columns() const { return columns_; }
+
+void MpvVideoWall::setColumns(int columns) {
+  columns = std::max(columns, 0);
+  if (columns != columns_) {
+    columns_ = columns;
+    emit columnsChanged();
+    polish();
+  }
+}
+
+int MpvVideoWall::rows() const { return rows_; }
+
+void MpvVideoWall::setRows(int rows) {
+  rows = std::max(rows, 0);
+  if (rows != rows_) {
+    rows_ = rows;
+    emit rowsChanged();
+    polish();
+  }
+}
+
+qreal MpvVideoWall::contentY() const { return content_y_; }
+
+void MpvVideoWall::setContentY(qreal y) {
+  if (y != content_y_) {
+    content_y_ = y;
+    emit contentYChanged();
+    polish();
+  }
+}
+
+qreal MpvVideoWall::contentHeight() const { return content_height_; }
+
+void MpvVideoWall::setContentHeight(qreal height) {
+  if (height != content_height_) {
+    content_height_ = height;
+    emit contentHeightChanged();
+  }
+}
+
+int MpvVideoWall::warmRows() const { return warm_rows_; }
+
+void MpvVideoWall::setWarmRows(int rows) {
+  rows = std::max(rows, 0);
+  if (rows != warm_rows_) {
+    warm_rows_ = rows;
+    emit warmRowsChanged();
+    polish();
+  }
+}
+
+int MpvVideoWall::poolCapacity() const { return pool_.capacity(); }
+
+void MpvVideoWall::setPoolCapacity(int capacity) {
+  if (capacity != pool_.capacity()) {
+    pool_.setCapacity(capacity);
+    emit poolCapacityChanged();
+  }
+}
+
+QObject* MpvVideoWall::playerAt(int index) const {
+  return cells_.value(index).player;
+}
+
+void MpvVideoWall::updatePolish() {
+  int columns = columnCount();
+  qreal cell_width = width() / columns;
+  qreal cell_height = cellHeight();
+  setContentHeight(rowCount() * cell_height);
+  if (source_list_.isEmpty() || cell_width <= 0 || cell_height <= 0) {
+    releaseAll();
+    return;
+  }
+
+  int first_row = std::floor(content_y_ / cell_height);
+  int last_row = std::ceil((content_y_ + height()) / cell_height) - 1;
+  int first_warm = std::max(first_row - warm_rows_, 0) * columns;
+  int last_warm = std::min((last_row + warm_rows_ + 1) * columns,
+                           int(source_list_.size())) - 1;
+
+  for (auto it = cells_.begin(); it != cells_.end();) {
+    if (it.key() < first_warm || it.key() > last_warm) {
+      pool_.release(it->player);
+      it = cells_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (int index = first_warm; index <= last_warm; ++index) {
+    int row = index / columns;
+    bool visible = row >= first_row && row <= last_row;
+    // Warm cells load paused, so they only decode their first frame
+    bool paused = !visible || isSourcePaused(index);
+    auto it = cells_.find(index);
+    if (it == cells_.end()) {
+      const Source& source = source_list_[index];
+      auto* player =
+          dynamic_cast<MpvPlayerQuickObject*>(pool_.acquire(source.name));
+      if (!player) {
+        continue;
+      }
+      player->setPaused(paused);
+      player->setUrl(source.url);
+      it = cells_.insert(index, Cell{player, paused});
+    } else if (it->paused != paused) {
+      it->player->setPaused(paused);
+      it->paused = paused;
+    }
+    it->player->setVisible(visible);
+    it->player->setPosition(QPointF((index % columns) * cell_width,
+                                    row * cell_height - content_y_));
+    it->player->setSize(QSizeF(cell_width, cell_height));
+  }
+}
+
+int MpvVideoWall::columnCount() const {
+  if (columns_ > 0) {
+    return columns_;
+  }
+  return std::max(int(std::ceil(std::sqrt(source_list_.size()))), 1);
+}
+
+int MpvVideoWall::rowCount() const {
+  int columns = columnCount();
+  return (int(source_list_.size()) + columns - 1) / columns;
+}
+
+qreal MpvVideoWall::cellHeight() const {
+  int rows = rows_ > 0 ? rows_ : rowCount();
+  return rows > 0 ? height() / rows : 0;
+}
+
+bool MpvVideoWall::isSourcePaused(int index) const {
+  const Source& source = source_list_[index];
+  return source.object ? source.object->property("paused").toBool()
+                       : source.paused;
+}
+
+void MpvVideoWall::sourcePausedChanged() { polish(); }
+
+void MpvVideoWall::releaseAll() {
+  for (const Cell& cell : std::exchange(cells_, {})) {
+    pool_.release(cell.player);
+  }
+}
@@ -0,0 +1,224 @@
+#include "MpvZapper.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Candidates decode every frame, so that promoting them does not touch a
+// vd-lavc option and reinitialize the decoder, which would keep a live source
+// on its last keyframe until the next GOP. They render with cheap scalers, at
+// a few frames per second and silently.
+const std::pair<const char*, const char*> kCandidateProperties[] = {
+    {"mute", "yes"},
+};
+constexpr MpvPlayer::QualityLevel kCandidateQuality =
+    MpvPlayer::BalancedQuality;
+constexpr double kCandidateFrameRate = 2;
+
+// Small cache of a candidate, kept by each load unlike cache properties
+MpvPlayer::CachePolicy candidateCachePolicy(const QUrl& url) {
+  constexpr qint64 MiB = 1024 * 1024;
+  MpvPlayer::CachePolicy policy =
+      MpvPlayer::CachePolicy::preset(MpvPlayer::sourceType(url));
+  policy.max_bytes = std::min(policy.max_bytes, 4 * MiB);
+  policy.max_back_bytes = 0;
+  policy.readahead_seconds = std::min(policy.readahead_seconds, 1.0);
+  return policy;
+}
+
+void raisePlayer(MpvPlayer* player, bool raise) {
+  if (QWidget* widget = dynamic_cast<QWidget*>(player)) {
+    raise ? widget->raise() : widget->lower();
+  } else if (QQuickItem* item = dynamic_cast<QQuickItem*>(player)) {
+    item->setZ(raise ? 1 : 0);
+  }
+}
+}  // namespace
+
+MpvZapper::MpvZapper(const MpvPlayerPool::Factory& factory, QObject* parent)
+    : QObject(parent), pool_(factory, 3) {}
+
+MpvZapper::~MpvZapper() { releaseAll(); }
+
+QList<QUrl> MpvZapper::urls() const { return urls_; }
+
+void MpvZapper::setUrls(const QList<QUrl>& urls) {
+  releaseAll();
+  urls_ = urls;
+  current_index_ = -1;
+  emit currentPlayerChanged(nullptr);
+  emit currentIndexChanged(current_index_);
+}
+
+int MpvZapper::prebufferCount() const { return prebuffer_count_; }
+
+void MpvZapper::setPrebufferCount(int count) {
+  prebuffer_count_ = std::max(count, 0);
+  pool_.setCapacity(prebuffer_count_ + 1);
+  if (current_index_ >= 0) {
+    updateCandidates();
+  }
+}
+
+int MpvZapper::currentIndex() const { return current_index_; }
+
+void MpvZapper::setCurrentIndex(int index) {
+  if (index < 0 || index >= urls_.size() || index == current_index_) {
+    return;
+  }
+
+  MpvPlayer* previous = current_player_;
+  MpvPlayer* player = candidates_.take(index);
+  if (player) {
+    promote(player);
+  } else {
+    player = load(index);
+  }
+  if (player) {
+    player->resume();
+    raisePlayer(player, true);
+  }
+
+  // The previous player stays connected if it is still a candidate
+  int previous_index = std::exchange(current_index_, index);
+  current_player_ = player;
+  if (previous) {
+    if (candidateIndexes().contains(previous_index)) {
+      demote(previous, urls_[previous_index]);
+      raisePlayer(previous, false);
+      candidates_.insert(previous_index, previous);
+    } else {
+      release(previous);
+    }
+  }
+  updateCandidates();
+
+  emit currentPlayerChanged(current_player_);
+  emit currentIndexChanged(current_index_);
+}
+
+void MpvZapper::next() {
+  int count = urls_.size();
+  if (count > 0) {
+    setCurrentIndex((current_index_ + 1) % count);
+  }
+}
+
+void MpvZapper::previous() {
+  int count = urls_.size();
+  if (count > 0) {
+    setCurrentIndex((current_index_ + count - 1) % count);
+  }
+}
+
+MpvPlayer* MpvZapper::currentPlayer() const { return current_player_; }
+
+bool MpvZapper::isPrebuffered(int index) const {
+  return candidates_.contains(index);
+}
+
+QList<int> MpvZapper::candidateIndexes() const {
+  QList<int> indexes;
+  int count = urls_.size();
+  int limit = std::min(prebuffer_count_, count - 1);
+  for (int distance = 1; distance < count && indexes.size() < limit;
+       ++distance) {
+    for (int index : {(current_index_ + distance) % count,
+                      ((current_index_ - distance) % count + count) % count}) {
+      if (!indexes.contains(index) && indexes.size() < limit) {
+        indexes << index;
+      }
+    }
+  }
+  return indexes;
+}
+
+MpvPlayer* MpvZapper::load(int index) {
+  const QUrl& url = urls_[index];
+  MpvPlayer* player = pool_.acquire(url.toString(QUrl::RemoveUserInfo));
+  if (player) {
+    player->setUrl(url);
+  }
+  return player;
+}
+
+void MpvZapper::demote(MpvPlayer* player, const QUrl& url) {
+  if (!saved_states_.contains(player)) {
+    SavedState saved;
+    saved.cache_policy = player->cachePolicy();
+    saved.quality_level = player->qualityLevel();
+    saved.max_frame_rate = player->maxFrameRate();
+    for (const auto& property : kCandidateProperties) {
+      saved.properties.insert(
+          property.first, player->getPlayerProperty<QVariant>(property.first));
+    }
+    saved_states_.insert(player, saved);
+  }
+  player->setCachePolicy(candidateCachePolicy(url));
+  // Players below the candidate quality keep their level, and with it their
+  // decoder options
+  player->setQualityLevel(
+      std::max(saved_states_[player].quality_level, kCandidateQuality));
+  player->setMaxFrameRate(kCandidateFrameRate);
+  for (const auto& property : kCandidateProperties) {
+    player->setPlayerProperty(property.first, property.second);
+  }
+}
+
+void MpvZapper::promote(MpvPlayer* player) {
+  if (!saved_states_.contains(player)) {
+    return;
+  }
+  SavedState saved = saved_states_.take(player);
+  player->setQualityLevel(saved.quality_level);
+  player->setMaxFrameRate(saved.max_frame_rate);
+  player->setCachePolicy(saved.cache_policy);
+  for (auto it = saved.properties.cbegin(); it != saved.properties.cend();
+       ++it) {
+    if (it.value().isValid()) {
+      player->setPlayerProperty(it.key(), it.value());
+    }
+  }
+}
+
+void MpvZapper::updateCandidates() {
+  QList<int> indexes = candidateIndexes();
+  for (auto it = candidates_.begin(); it != candidates_.end();) {
+    if (indexes.contains(it.key())) {
+      ++it;
+    } else {
+      release(it.value());
+      it = candidates_.erase(it);
+    }
+  }
+  for (int index : indexes) {
+    if (candidates_.contains(index)) {
+      continue;
+    }
+    MpvPlayer* player =
+        pool_.acquire(urls_[index].toString(QUrl::RemoveUserInfo));
+    if (!player) {
+      continue;
+    }
+    // Demoted before the load, so the source never plays at full cost
+    demote(player, urls_[index]);
+    raisePlayer(player, false);
+    player->play(urls_[index]);
+    candidates_.insert(index, player);
+  }
+}
+
+void MpvZapper::release(MpvPlayer* player) {
+  // Everything set by demote() is reset by the pool
+  saved_states_.remove(player);
+  pool_.release(player);
+}
+
+void MpvZapper::releaseAll() {
+  for (MpvPlayer* player : std::exchange(candidates_, {})) {
+    release(player);
+  }
+  if (current_player_) {
+    release(std::exchange(current_player_, nullptr));
+  }
+}
@@ -54,9 +54,15 @@ static inline QVariant node_to_variant(const mpv_node *node)
         return QVariant(static_cast<qlonglong>(node->u.int64));
     case MPV_FORMAT_DOUBLE:
         return QVariant(node->u.double_);
+    case MPV_FORMAT_BYTE_ARRAY: {
+        mpv_byte_array *array = node->u.ba;
+        return QVariant(QByteArray(static_cast<const char *>(array->data),
+                                   static_cast<int>(array->size)));
+    }
     case MPV_FORMAT_NODE_ARRAY: {
         mpv_node_list *list = node->u.list;
         QVariantList qlist;
+        qlist.reserve(list->num);
         for (int n = 0; n < list->num; n++)
             qlist.append(node_to_variant(&list->values[n]));
         return QVariant(qlist);
@@ -138,27 +144,38 @@ private:
         } else if (test_type(src, QMetaType::Double)) {
             dst->format = MPV_FORMAT_DOUBLE;
             dst->u.double_ = src.toDouble();
+        } else if (test_type(src, QMetaType::QByteArray)) {
+            QByteArray b = src.toByteArray();
+            dst->format = MPV_FORMAT_BYTE_ARRAY;
+            dst->u.ba = new mpv_byte_array();
+            dst->u.ba->data = new char[b.size()];
+            dst->u.ba->size = b.size();
+            std::memcpy(dst->u.ba->data, b.constData(), b.size());
         } else if (src.canConvert<QVariantList>()) {
             QVariantList qlist = src.toList();
             mpv_node_list *list = create_list(dst, false, qlist.size());
             if (!list)
                 goto fail;
             list->num = qlist.size();
+            // at() does not detach the list shared with src
             for (int n = 0; n < qlist.size(); n++)
-                set(&list->values[n], qlist[n]);
+                set(&list->values[n], qlist.at(n));
         } else if (src.canConvert<QVariantMap>()) {
             QVariantMap qmap = src.toMap();
             mpv_node_list *list = create_list(dst, true, qmap.size());
             if (!list)
                 goto fail;
             list->num = qmap.size();
-            for (int n = 0; n < qmap.size(); n++) {
-                list->keys[n] = dup_qstring(qmap.keys()[n]);
+            // keys()[n] and values()[n] would copy the map's keys and values
+            // for every entry.
+            int n = 0;
+            for (auto it = qmap.cbegin(); it != qmap.cend(); ++it, ++n) {
+                list->keys[n] = dup_qstring(it.key());
                 if (!list->keys[n]) {
                     free_node(dst);
                     goto fail;
                 }
-                set(&list->values[n], qmap.values()[n]);
+                set(&list->values[n], it.value());
             }
         } else {
             goto fail;
@@ -172,6 +189,11 @@ private:
         case MPV_FORMAT_STRING:
             delete[] dst->u.string;
             break;
+        case MPV_FORMAT_BYTE_ARRAY:
+            if (dst->u.ba)
+                delete[] static_cast<char *>(dst->u.ba->data);
+            delete dst->u.ba;
+            break;
         case MPV_FORMAT_NODE_ARRAY:
         case MPV_FORMAT_NODE_MAP: {
             mpv_node_list *list = dst->u.list;